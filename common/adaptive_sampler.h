@@ -0,0 +1,57 @@
+/*
+    Adaptive Sampler
+    Drops to a slow idle rate once the cursor has been parked for a few
+    samples and snaps back to the configured Interval on the first movement.
+*/
+
+#ifndef ADAPTIVE_SAMPLER_H
+#define ADAPTIVE_SAMPLER_H
+
+class AdaptiveSampler {
+public:
+    AdaptiveSampler() : m_activeMs(10), m_idleMs(0), m_idleAfter(5) { Reset(); }
+
+    // idleMs <= activeMs disables adaptation (always sample at activeMs)
+    void Configure(int activeMs, int idleMs, int idleAfter) {
+        m_activeMs = activeMs;
+        m_idleMs = idleMs;
+        m_idleAfter = idleAfter > 0 ? idleAfter : 1;
+        Reset();
+    }
+
+    void Reset() {
+        m_still = 0;
+        m_hasLast = false;
+        m_lastX = m_lastY = 0;
+    }
+
+    // Feed every sample; returns the delay in ms before the next one
+    int Next(int x, int y) {
+        if (m_hasLast && x == m_lastX && y == m_lastY) {
+            if (m_still < m_idleAfter) m_still++;
+        } else {
+            m_still = 0;
+        }
+        m_hasLast = true;
+        m_lastX = x;
+        m_lastY = y;
+        return GetInterval();
+    }
+
+    int GetInterval() const {
+        if (m_idleMs <= m_activeMs) return m_activeMs;
+        return m_still >= m_idleAfter ? m_idleMs : m_activeMs;
+    }
+    bool IsIdle() const { return GetInterval() != m_activeMs; }
+
+private:
+    int m_activeMs;
+    int m_idleMs;
+    int m_idleAfter;
+
+    int m_still;
+    bool m_hasLast;
+    int m_lastX, m_lastY;
+};
+
+#endif
@@ -0,0 +1,250 @@
+#include "async_logger.h"
+#include "trail_clock.h"
+#ifndef _WIN32
+#include "trail_stream.h"
+#endif
+
+AsyncTrailLogger::AsyncTrailLogger()
+    : m_stream(NULL), m_target(TARGET_FILE), m_indexEvery(0), m_open(false), m_pending(false), m_stop(false),
+      m_maxDepth(0), m_lastWriteNs(0), m_maxWriteNs(0), m_batches(0), m_rotateFailures(0), m_rotateFailing(false) {}
+
+AsyncTrailLogger::~AsyncTrailLogger() {
+    Close();
+}
+
+void AsyncTrailLogger::SetCommitPolicy(int maxSamples, int maxMs, TrailDurability durability) {
+    m_writer.SetCommitPolicy(maxSamples, maxMs, durability);
+    m_ring.SetCommitPolicy(maxMs, durability);
+    m_segments.SetCommitPolicy(maxSamples, maxMs, durability);
+}
+
+void AsyncTrailLogger::SetSegmentLimits(int maxMB, int maxMinutes, int keep) {
+    m_segments.SetSegmentLimits(maxMB, maxMinutes, keep);
+}
+
+void AsyncTrailLogger::SetIndexEvery(int everySamples) {
+    m_indexEvery = everySamples;
+    m_segments.SetIndexEvery(everySamples);
+}
+
+void AsyncTrailLogger::Open(FILE* f, int intervalMs, TrailFormat format, int screenW, int screenH, FILE* index) {
+    Close();
+    m_writer.Open(f, intervalMs, format, screenW, screenH);
+    if (index) m_writer.OpenIndex(index, m_indexEvery);
+    m_target = TARGET_FILE;
+    Start();
+}
+
+bool AsyncTrailLogger::OpenRing(const char* path, size_t ringBytes, int intervalMs, int screenW, int screenH) {
+    Close();
+    if (!m_ring.Open(path, ringBytes, intervalMs, screenW, screenH)) return false;
+    m_target = TARGET_RING;
+    Start();
+    return true;
+}
+
+bool AsyncTrailLogger::OpenSegments(const char* base, bool append, int intervalMs, TrailFormat format,
+                                    int screenW, int screenH) {
+    Close();
+    if (!m_segments.Open(base, append, intervalMs, format, screenW, screenH)) return false;
+    m_target = TARGET_SEGMENTS;
+    Start();
+    return true;
+}
+
+#ifndef _WIN32
+void AsyncTrailLogger::OpenStream(TrailStream* stream, int intervalMs, int screenW, int screenH) {
+    Close();
+    m_stream = stream;
+    m_stream->Begin(intervalMs, screenW, screenH);
+    m_target = TARGET_STREAM;
+    Start();
+}
+#endif
+
+void AsyncTrailLogger::Start() {
+    m_front.samples.clear();
+    m_front.windows.clear();
+    m_pending = false;
+    m_stop = false;
+    m_maxDepth.store(0);
+    m_lastWriteNs.store(0);
+    m_maxWriteNs.store(0);
+    m_batches.store(0);
+    m_rotateFailures.store(0);
+    m_rotateFailing.store(false);
+
+    m_thread = std::thread(&AsyncTrailLogger::Run, this);
+    m_open = true;
+}
+
+void AsyncTrailLogger::Append(const TrailSample& s) {
+    if (!m_open) return;
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_front.samples.push_back(s);
+    size_t depth = m_front.samples.size();
+    if (depth > m_maxDepth.load(std::memory_order_relaxed)) m_maxDepth.store(depth, std::memory_order_relaxed);
+    if (depth >= WAKE_DEPTH && !m_pending) {
+        m_pending = true;
+        m_wake.notify_one();
+    }
+}
+
+void AsyncTrailLogger::WriteWindow(int id, unsigned long long handle, const char* name) {
+    if (!m_open) return;
+
+    WindowDef w;
+    w.id = id;
+    w.handle = handle;
+    w.name = name ? name : "";
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    w.before = m_front.samples.size();
+    m_front.windows.push_back(w);
+}
+
+void AsyncTrailLogger::Flush() {
+    if (!m_open) return;
+
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (m_front.samples.empty() && m_front.windows.empty()) return;
+    m_pending = true;
+    m_wake.notify_one();
+}
+
+void AsyncTrailLogger::Close() {
+    if (!m_open) return;
+
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stop = true;
+        m_wake.notify_one();
+    }
+    m_thread.join(); // Logger writes the rest before it exits
+    if (m_target == TARGET_RING) m_ring.Close();
+    else if (m_target == TARGET_SEGMENTS) m_segments.Close();
+#ifndef _WIN32
+    else if (m_target == TARGET_STREAM) m_stream->End();
+#endif
+    else m_writer.Close();
+    m_open = false;
+}
+
+unsigned long long AsyncTrailLogger::GetSampleCount() const {
+#ifndef _WIN32
+    if (m_target == TARGET_STREAM) return m_stream->GetSampleCount();
+#endif
+    if (m_target == TARGET_RING) return m_ring.GetSampleCount();
+    if (m_target == TARGET_SEGMENTS) return m_segments.GetSampleCount();
+    return m_writer.GetSampleCount();
+}
+
+unsigned long long AsyncTrailLogger::GetRecordCount() const {
+#ifndef _WIN32
+    if (m_target == TARGET_STREAM) return m_stream->GetSampleCount(); // One record per sample
+#endif
+    if (m_target == TARGET_RING) return m_ring.GetRecordCount();
+    if (m_target == TARGET_SEGMENTS) return m_segments.GetRecordCount();
+    return m_writer.GetRecordCount();
+}
+
+unsigned long long AsyncTrailLogger::GetCommitCount() const {
+    if (m_target == TARGET_RING || m_target == TARGET_STREAM) return 0;
+    if (m_target == TARGET_SEGMENTS) return m_segments.GetCommitCount();
+    return m_writer.GetCommitCount();
+}
+
+unsigned long long AsyncTrailLogger::GetSyncCount() const {
+    if (m_target == TARGET_STREAM) return 0;
+    if (m_target == TARGET_RING) return m_ring.GetSyncCount();
+    if (m_target == TARGET_SEGMENTS) return m_segments.GetSyncCount();
+    return m_writer.GetSyncCount();
+}
+
+unsigned long long AsyncTrailLogger::GetDroppedCount() const {
+#ifndef _WIN32
+    if (m_target == TARGET_STREAM) return m_stream->GetDroppedCount();
+#endif
+    return 0;
+}
+
+size_t AsyncTrailLogger::GetQueueDepth() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return m_front.samples.size();
+}
+
+void AsyncTrailLogger::Run() {
+    Buffer back;
+
+    for (;;) {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_wake.wait(lock, [this] { return m_pending || m_stop; });
+            std::swap(m_front, back);
+            m_pending = false;
+            stop = m_stop;
+        }
+
+        if (!back.samples.empty() || !back.windows.empty()) {
+            long long start = GetMonotonicNs();
+            WriteBuffer(back);
+            long long took = GetMonotonicNs() - start;
+
+            m_lastWriteNs.store(took);
+            if (took > m_maxWriteNs.load()) m_maxWriteNs.store(took);
+            m_batches.fetch_add(1);
+        }
+
+        // Everything appended before Close() was in this swap
+        if (stop) return;
+    }
+}
+
+// Window definitions go out right before the first sample that could use them
+template <class Writer>
+void AsyncTrailLogger::WriteTo(Writer& out, const Buffer& b) {
+    size_t w = 0;
+    for (size_t i = 0; i < b.samples.size(); ++i) {
+        for (; w < b.windows.size() && b.windows[w].before <= i; ++w) {
+            out.WriteWindow(b.windows[w].id, b.windows[w].handle, b.windows[w].name.c_str());
+        }
+        out.Append(b.samples[i]);
+    }
+    for (; w < b.windows.size(); ++w) {
+        out.WriteWindow(b.windows[w].id, b.windows[w].handle, b.windows[w].name.c_str());
+    }
+}
+
+void AsyncTrailLogger::WriteBuffer(Buffer& b) {
+    if (m_target == TARGET_RING) {
+        for (size_t i = 0; i < b.samples.size(); ++i) m_ring.Append(b.samples[i]);
+        m_ring.Flush();
+        b.samples.clear();
+        b.windows.clear();
+        return;
+    }
+
+    if (m_target == TARGET_SEGMENTS) {
+        WriteTo(m_segments, b);
+        // Still logging to the old segment; tell the UI and retry next batch
+        bool rotated = m_segments.Flush();
+        if (!rotated) m_rotateFailures.fetch_add(1);
+        m_rotateFailing.store(!rotated);
+    }
+#ifndef _WIN32
+    else if (m_target == TARGET_STREAM) {
+        WriteTo(*m_stream, b);
+        m_stream->Flush();
+    }
+#endif
+    else {
+        WriteTo(m_writer, b);
+        m_writer.Flush();
+    }
+
+    // Keeps the capacity, so steady state allocates nothing
+    b.samples.clear();
+    b.windows.clear();
+}
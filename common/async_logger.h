@@ -0,0 +1,143 @@
+/*
+    Async Trail Logger
+    Moves all log file I/O off the UI thread. The UI appends into a front
+    buffer (a short lock, no I/O); a logger thread swaps it with its back
+    buffer and feeds the back buffer to a TrailWriter, so a slow disk or an
+    NFS home directory only delays the logger, never the overlay.
+
+    Close() hands over whatever is still buffered, waits for the logger to
+    write it and closes the file before returning, so the tail is never lost
+    and the file is complete once Close() returns.
+
+    OpenRing() sends the samples to a TrailRing instead (AutoClear=2), and
+    OpenSegments() to a TrailSegmentWriter (SegmentMB / SegmentMinutes);
+    either way all of their I/O also happens on the logger thread.
+    OpenStream() (Linux) feeds a TrailStream (--output); a reader that
+    can't keep up then stalls the logger thread, never the capture.
+*/
+
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <stdio.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trail_log.h"
+#include "trail_ring.h"
+#include "trail_segments.h"
+
+class TrailStream;
+
+class AsyncTrailLogger {
+public:
+    AsyncTrailLogger();
+    ~AsyncTrailLogger();
+
+    // Same meaning as on TrailWriter; set before Open
+    void SetCommitPolicy(int maxSamples, int maxMs, TrailDurability durability);
+    // See TrailSegmentWriter; set before OpenSegments
+    void SetSegmentLimits(int maxMB, int maxMinutes, int keep);
+    // Samples between index entries (0 = no index); set before Open
+    void SetIndexEvery(int everySamples);
+    // Opens the files of a segmented log; set before OpenSegments
+    void SetFileOpener(TrailFileOpener opener) { m_segments.SetFileOpener(opener); }
+
+    // Takes ownership of f (and index, the .idx sidecar, if given), writes
+    // the header and starts the logger thread
+    void Open(FILE* f, int intervalMs, TrailFormat format = TRAIL_FORMAT_TEXT,
+              int screenW = 0, int screenH = 0, FILE* index = NULL);
+    // Same, for a ring file of ringBytes (see trail_ring.h). False if it can't be mapped.
+    bool OpenRing(const char* path, size_t ringBytes, int intervalMs, int screenW, int screenH);
+    // Same, for segment files plus a manifest named after base (see trail_segments.h)
+    bool OpenSegments(const char* base, bool append, int intervalMs, TrailFormat format,
+                      int screenW, int screenH);
+#ifndef _WIN32
+    // Same, for an open stream (not owned); Close() ends the session but
+    // leaves the stream open for the next one
+    void OpenStream(TrailStream* stream, int intervalMs, int screenW, int screenH);
+#endif
+    bool IsOpen() const { return m_open; }
+
+    // UI side, never touches the disk
+    void Append(const TrailSample& s);
+    void WriteWindow(int id, unsigned long long handle, const char* name);
+    // Wakes the logger to write what has been appended so far
+    void Flush();
+    // Drains, closes the file and joins the logger thread
+    void Close();
+
+    // Live stats (any thread)
+    size_t GetQueueDepth();                   // samples waiting in the front buffer
+    size_t GetMaxQueueDepth() const { return m_maxDepth.load(); }
+    long long GetLastWriteNs() const { return m_lastWriteNs.load(); } // last batch, swap to commit
+    long long GetMaxWriteNs() const { return m_maxWriteNs.load(); }
+    unsigned long long GetBatchCount() const { return m_batches.load(); }
+    // Segments: true while the next segment can't be created (disk full,
+    // EMFILE, permissions). Samples keep going to the current one.
+    bool IsRotationFailing() const { return m_rotateFailing.load(); }
+    unsigned long long GetRotateFailureCount() const { return m_rotateFailures.load(); }
+
+    // Writer stats, valid after Close()
+    unsigned long long GetSampleCount() const;
+    unsigned long long GetRecordCount() const;
+    unsigned long long GetCommitCount() const;
+    unsigned long long GetSyncCount() const;
+    unsigned long long GetSegmentCount() const { return m_target == TARGET_SEGMENTS ? m_segments.GetSegmentCount() : 0; }
+    unsigned long long GetDroppedCount() const; // Stream samples dropped (StreamFull=drop)
+
+private:
+    // Wake the logger without a Flush() once this much is queued
+    static const size_t WAKE_DEPTH = 4096;
+
+    enum Target {
+        TARGET_FILE,
+        TARGET_RING,
+        TARGET_SEGMENTS,
+        TARGET_STREAM
+    };
+
+    struct WindowDef {
+        size_t before; // index of the first sample that may use it
+        int id;
+        unsigned long long handle;
+        std::string name;
+    };
+
+    struct Buffer {
+        std::vector<TrailSample> samples;
+        std::vector<WindowDef> windows;
+    };
+
+    void Start();
+    void Run();
+    void WriteBuffer(Buffer& b);
+    template <class Writer> void WriteTo(Writer& out, const Buffer& b);
+
+    TrailWriter m_writer; // Logger thread only while open
+    TrailRing m_ring;     // Same, in ring mode
+    TrailSegmentWriter m_segments; // Same, when segmented
+    TrailStream* m_stream; // Same, when streaming (not owned)
+    Target m_target;
+    int m_indexEvery;
+    std::thread m_thread;
+    bool m_open;
+
+    std::mutex m_lock;
+    std::condition_variable m_wake;
+    Buffer m_front;   // Guarded by m_lock
+    bool m_pending;   // Flush() requested
+    bool m_stop;
+
+    std::atomic<size_t> m_maxDepth;
+    std::atomic<long long> m_lastWriteNs;
+    std::atomic<long long> m_maxWriteNs;
+    std::atomic<unsigned long long> m_batches;
+    std::atomic<unsigned long long> m_rotateFailures;
+    std::atomic<bool> m_rotateFailing;
+};
+
+#endif
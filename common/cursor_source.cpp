@@ -0,0 +1,74 @@
+#include "cursor_source.h"
+#include "trail_log.h"
+
+#include <stdio.h>
+#include <math.h>
+
+// Replay
+
+ReplayCursorSource::ReplayCursorSource() : m_index(0), m_repeat(0), m_loops(0) {}
+
+bool ReplayCursorSource::Open(const char* path) {
+    m_points.clear();
+    m_index = 0;
+    m_repeat = 0;
+    m_loops = 0;
+
+    TrailReader reader;
+    if (!reader.Open(fopen(path, "rb"))) return false;
+
+    TrailSample s;
+    long long count;
+    while (reader.Next(s, count)) {
+        Run r = { s.x, s.y, count };
+        m_points.push_back(r);
+    }
+    return !m_points.empty();
+}
+
+bool ReplayCursorSource::GetPosition(int& x, int& y) {
+    if (m_points.empty()) return false;
+
+    const Run& r = m_points[m_index];
+    x = r.x;
+    y = r.y;
+
+    if (++m_repeat >= r.count) {
+        m_repeat = 0;
+        if (++m_index >= m_points.size()) {
+            m_index = 0;
+            m_loops++;
+        }
+    }
+    return true;
+}
+
+// Synthetic
+
+static const unsigned long long MOVE_STEPS = 400;  // moving this many samples,
+static const unsigned long long PAUSE_STEPS = 100; // then parked for this many
+
+SyntheticCursorSource::SyntheticCursorSource(int screenW, int screenH, unsigned int seed)
+    : m_screenW(screenW), m_screenH(screenH), m_step(0), m_lastX(screenW / 2), m_lastY(screenH / 2) {
+    // Small LCG so the figure depends only on the seed, not on rand() state
+    unsigned int state = seed * 1103515245u + 12345u;
+    m_freqX = 0.005 + (state % 1000) / 100000.0;
+    state = state * 1103515245u + 12345u;
+    m_freqY = 0.007 + (state % 1000) / 100000.0;
+    state = state * 1103515245u + 12345u;
+    m_phase = (state % 6283) / 1000.0;
+}
+
+bool SyntheticCursorSource::GetPosition(int& x, int& y) {
+    unsigned long long cycle = m_step % (MOVE_STEPS + PAUSE_STEPS);
+    m_step++;
+
+    if (cycle < MOVE_STEPS) {
+        double t = (double)m_step;
+        m_lastX = (int)((m_screenW - 1) * (0.5 + 0.45 * sin(m_freqX * t + m_phase)));
+        m_lastY = (int)((m_screenH - 1) * (0.5 + 0.45 * sin(m_freqY * t)));
+    }
+    x = m_lastX;
+    y = m_lastY;
+    return true;
+}
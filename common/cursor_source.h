@@ -0,0 +1,89 @@
+/*
+    Cursor Source
+    Where cursor positions come from. Frontends and games read the cursor
+    only through this interface, so the logging, overlay and game paths can
+    be driven from a recorded log or a generator instead of the real
+    pointer, at any sample rate and without a display.
+
+    Platform sources live with their frontend (X11 in main_linux.cpp,
+    Hyprland in main_hyprland.cpp). Win32CursorSource is below because the
+    Windows games share it.
+*/
+
+#ifndef CURSOR_SOURCE_H
+#define CURSOR_SOURCE_H
+
+#include <vector>
+#include "trail_sample.h"
+#include "trail_clock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+class CursorSource {
+public:
+    virtual ~CursorSource() {}
+
+    // Current position. Returns false if it could not be read.
+    virtual bool GetPosition(int& x, int& y) = 0;
+
+    // Position stamped with the capture time. Sources that know more
+    // (buttons, window) override this.
+    virtual bool Sample(TrailSample& s) {
+        if (!GetPosition(s.x, s.y)) return false;
+        s.t = GetMonotonicNs();
+        return true;
+    }
+};
+
+// Plays a trail log (text or binary) back one recorded sample per call (runs are expanded),
+// looping at the end. Pacing is up to the caller's sample rate.
+class ReplayCursorSource : public CursorSource {
+public:
+    ReplayCursorSource();
+
+    bool Open(const char* path);
+    bool GetPosition(int& x, int& y) override;
+
+    size_t GetLength() const { return m_points.size(); }
+    unsigned long long GetLoops() const { return m_loops; }
+
+private:
+    struct Run { int x, y; long long count; };
+    std::vector<Run> m_points;
+    size_t m_index;
+    long long m_repeat;
+    unsigned long long m_loops;
+};
+
+// Deterministic generator: a Lissajous sweep over the screen with regular
+// pauses, so both the moving and the parked paths (RLE, idle sampling) get
+// exercised. Same seed, same sequence.
+class SyntheticCursorSource : public CursorSource {
+public:
+    SyntheticCursorSource(int screenW = 1920, int screenH = 1080, unsigned int seed = 1);
+
+    bool GetPosition(int& x, int& y) override;
+
+private:
+    int m_screenW, m_screenH;
+    double m_freqX, m_freqY, m_phase;
+    unsigned long long m_step;
+    int m_lastX, m_lastY;
+};
+
+#ifdef _WIN32
+class Win32CursorSource : public CursorSource {
+public:
+    bool GetPosition(int& x, int& y) override {
+        POINT p;
+        if (!GetCursorPos(&p)) return false;
+        x = p.x;
+        y = p.y;
+        return true;
+    }
+};
+#endif
+
+#endif
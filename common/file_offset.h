@@ -0,0 +1,32 @@
+/*
+    File Offset
+    64-bit fseek/ftell. Plain ones take a long, which is 32 bits on
+    Windows, so logs past 2 GB would seek to the wrong place.
+*/
+
+#ifndef FILE_OFFSET_H
+#define FILE_OFFSET_H
+
+#include <stdio.h>
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+inline int SeekFile64(FILE* f, long long offset, int origin) {
+#ifdef _WIN32
+    return _fseeki64(f, offset, origin);
+#else
+    return fseeko(f, (off_t)offset, origin);
+#endif
+}
+
+// -1 on error, like ftell
+inline long long TellFile64(FILE* f) {
+#ifdef _WIN32
+    return _ftelli64(f);
+#else
+    return (long long)ftello(f);
+#endif
+}
+
+#endif
@@ -0,0 +1,149 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+    : m_data(NULL), m_size(0), m_existed(false), m_ownsFile(true), m_file(INVALID_HANDLE_VALUE), m_mapping(NULL) {}
+
+bool MappedFile::Open(const char* path, size_t size) {
+    Close();
+    m_ownsFile = true;
+
+    m_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                         OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER current;
+    m_existed = GetFileSizeEx(m_file, &current) && (unsigned long long)current.QuadPart == size;
+
+    // The mapping grows the file to size and allocates it
+    unsigned long long size64 = size;
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READWRITE,
+                                   (DWORD)(size64 >> 32), (DWORD)(size64 & 0xFFFFFFFF), NULL);
+    if (m_mapping) m_data = (unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, size);
+    if (!m_data) {
+        Close();
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+bool MappedFile::OpenRead(FILE* f) {
+    Close();
+    m_ownsFile = false;
+    m_existed = true;
+    m_file = (HANDLE)_get_osfhandle(_fileno(f));
+    LARGE_INTEGER size;
+    if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size) || size.QuadPart == 0 ||
+        (unsigned long long)size.QuadPart > (size_t)-1) {
+        Close();
+        return false;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_mapping) m_data = (unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_data) {
+        Close();
+        return false;
+    }
+    m_size = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE && m_ownsFile) CloseHandle(m_file);
+    m_data = NULL;
+    m_mapping = NULL;
+    m_file = INVALID_HANDLE_VALUE;
+    m_size = 0;
+}
+
+void MappedFile::Sync(bool wait) {
+    if (!m_data) return;
+    FlushViewOfFile(m_data, 0);
+    if (wait) FlushFileBuffers(m_file);
+}
+
+#else
+
+MappedFile::MappedFile() : m_data(NULL), m_size(0), m_existed(false), m_ownsFile(true), m_fd(-1) {}
+
+bool MappedFile::Open(const char* path, size_t size) {
+    Close();
+    m_ownsFile = true;
+
+    m_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd < 0) return false;
+
+    struct stat st;
+    m_existed = fstat(m_fd, &st) == 0 && (size_t)st.st_size == size;
+    if (!m_existed) {
+        // Reserve the blocks now, a store into a sparse hole could SIGBUS on a full disk
+        if (ftruncate(m_fd, (off_t)size) < 0 || posix_fallocate(m_fd, 0, (off_t)size) != 0) {
+            Close();
+            return false;
+        }
+    }
+
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (p == MAP_FAILED) {
+        Close();
+        return false;
+    }
+    m_data = (unsigned char*)p;
+    m_size = size;
+    return true;
+}
+
+bool MappedFile::OpenRead(FILE* f) {
+    Close();
+    m_ownsFile = false;
+    m_existed = true;
+    m_fd = fileno(f);
+    struct stat st;
+    if (m_fd < 0 || fstat(m_fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        Close();
+        return false;
+    }
+
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (p == MAP_FAILED) {
+        Close();
+        return false;
+    }
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL); // Read front to back, like fgets did
+    m_data = (unsigned char*)p;
+    m_size = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) munmap(m_data, m_size);
+    if (m_fd >= 0 && m_ownsFile) close(m_fd);
+    m_data = NULL;
+    m_fd = -1;
+    m_size = 0;
+}
+
+void MappedFile::Sync(bool wait) {
+    if (!m_data) return;
+    msync(m_data, m_size, wait ? MS_SYNC : MS_ASYNC);
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
@@ -0,0 +1,53 @@
+/*
+    Mapped File
+    A file of fixed size mapped read/write into memory (mmap on POSIX,
+    a file mapping on Windows). Creating or resizing preallocates the
+    blocks, so stores into the mapping never hit a full disk later.
+    OpenRead() maps an already opened file read-only instead (readers).
+*/
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Opens or creates path and resizes it to size bytes
+    bool Open(const char* path, size_t size);
+    // Maps all of f read-only; f stays open and owned by the caller.
+    // False for an empty file or one that can't be mapped (a pipe).
+    bool OpenRead(FILE* f);
+    void Close();
+
+    bool IsOpen() const { return m_data != NULL; }
+    unsigned char* Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+    // true if the file already had this size (existing contents kept)
+    bool Existed() const { return m_existed; }
+
+    // wait = false only queues write-back, wait = true returns once it is on disk
+    void Sync(bool wait);
+
+private:
+    unsigned char* m_data;
+    size_t m_size;
+    bool m_existed;
+    bool m_ownsFile; // false after OpenRead
+#ifdef _WIN32
+    HANDLE m_file;
+    HANDLE m_mapping;
+#else
+    int m_fd;
+#endif
+};
+
+#endif
@@ -0,0 +1,98 @@
+/*
+    Sample Ring
+    Fixed-capacity single-producer / single-consumer ring buffer.
+    The capture thread pushes, the UI / logger thread drains. Neither side
+    ever blocks: when the ring is full new samples are dropped and counted.
+*/
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <atomic>
+#include <vector>
+#include <stddef.h>
+
+template <typename T>
+class SampleRing {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SampleRing(size_t capacity = 8192)
+        : m_head(0), m_tail(0), m_dropped(0), m_overflows(0), m_highWater(0), m_wasFull(false) {
+        size_t cap = 1;
+        while (cap < capacity) cap <<= 1;
+        m_buffer.resize(cap);
+        m_mask = cap - 1;
+    }
+
+    // Producer side
+    bool Push(const T& item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t tail = m_tail.load(std::memory_order_acquire);
+        size_t used = head - tail;
+
+        if (used > m_mask) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            if (!m_wasFull) m_overflows.fetch_add(1, std::memory_order_relaxed);
+            m_wasFull = true;
+            return false;
+        }
+        m_wasFull = false;
+
+        m_buffer[head & m_mask] = item;
+        m_head.store(head + 1, std::memory_order_release);
+
+        if (used + 1 > m_highWater.load(std::memory_order_relaxed))
+            m_highWater.store(used + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Consumer side. Copies up to maxCount items into out, returns the count.
+    size_t Drain(T* out, size_t maxCount) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+        size_t count = head - tail;
+        if (count > maxCount) count = maxCount;
+
+        for (size_t i = 0; i < count; ++i) out[i] = m_buffer[(tail + i) & m_mask];
+        m_tail.store(tail + count, std::memory_order_release);
+        return count;
+    }
+
+    bool Pop(T& out) { return Drain(&out, 1) == 1; }
+
+    // Either side (approximate while the other side is running)
+    size_t Size() const {
+        return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire);
+    }
+    size_t Capacity() const { return m_mask + 1; }
+
+    // Stats: samples lost, times the ring ran full, deepest fill level seen
+    unsigned long long GetDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+    unsigned long long GetOverflows() const { return m_overflows.load(std::memory_order_relaxed); }
+    size_t GetHighWater() const { return m_highWater.load(std::memory_order_relaxed); }
+
+    // Only call while neither side is running
+    void Reset() {
+        m_head.store(0);
+        m_tail.store(0);
+        m_dropped.store(0);
+        m_overflows.store(0);
+        m_highWater.store(0);
+        m_wasFull = false;
+    }
+
+private:
+    std::vector<T> m_buffer;
+    size_t m_mask;
+
+    // Separate cache lines so producer and consumer don't false-share
+    alignas(64) std::atomic<size_t> m_head;
+    alignas(64) std::atomic<size_t> m_tail;
+
+    alignas(64) std::atomic<unsigned long long> m_dropped;
+    std::atomic<unsigned long long> m_overflows;
+    std::atomic<size_t> m_highWater;
+    bool m_wasFull; // producer only
+};
+
+#endif
@@ -0,0 +1,46 @@
+/*
+    Trail Clock
+    Monotonic nanosecond timestamps for samples, plus a wall-clock reading
+    to anchor a session so monotonic times can be mapped back to real time.
+*/
+
+#ifndef TRAIL_CLOCK_H
+#define TRAIL_CLOCK_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Never jumps when the wall clock is adjusted
+inline long long GetMonotonicNs() {
+#ifdef _WIN32
+    static LARGE_INTEGER freq = {};
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (long long)(now.QuadPart / freq.QuadPart) * 1000000000LL +
+           (long long)(now.QuadPart % freq.QuadPart) * 1000000000LL / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+// Unix epoch nanoseconds
+inline long long GetWallClockNs() {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    unsigned long long t = ((unsigned long long)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (long long)(t - 116444736000000000ULL) * 100; // 100ns ticks since 1601
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include "trail_columns.h"
+
+#include <string.h>
+
+static const size_t COLUMN_HEADER_SIZE = 9;
+
+static void PutLE(unsigned char* p, unsigned long long v, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static unsigned long long GetLE(const unsigned char* p, int bytes) {
+    unsigned long long v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+// --- TrailChunkFilter ---
+
+TrailChunkFilter::TrailChunkFilter()
+    : fromT(-0x7fffffffffffffffLL - 1), toT(0x7fffffffffffffffLL),
+      minX(-0x7fffffff - 1), minY(-0x7fffffff - 1), maxX(0x7fffffff), maxY(0x7fffffff) {}
+
+bool TrailChunkFilter::Overlaps(const TrailChunkStats& stats) const {
+    return stats.t1 >= fromT && stats.t0 <= toT &&
+           stats.maxX >= minX && stats.minX <= maxX && stats.maxY >= minY && stats.minY <= maxY;
+}
+
+bool TrailChunkFilter::Contains(const TrailSample& s, long long runEnd) const {
+    return runEnd >= fromT && s.t <= toT && s.x >= minX && s.x <= maxX && s.y >= minY && s.y <= maxY;
+}
+
+// --- TrailColumns ---
+
+void TrailColumns::Clear() {
+    t.clear();
+    count.clear();
+    last.clear();
+    x.clear();
+    y.clear();
+    window.clear();
+    buttons.clear();
+}
+
+void TrailColumns::Push(const TrailSample& s, long long runCount, long long runEnd) {
+    t.push_back(s.t);
+    count.push_back(runCount);
+    last.push_back(runEnd);
+    x.push_back(s.x);
+    y.push_back(s.y);
+    window.push_back(s.window);
+    buttons.push_back(s.buttons);
+}
+
+// --- Encoding ---
+
+// Element copies through memcpy compile to plain loads/stores
+template <typename U, typename T>
+static void Pack(const std::vector<T>& v, long long base, unsigned char* dst) {
+    for (size_t i = 0; i < v.size(); ++i) {
+        U u = (U)((long long)v[i] - base);
+        memcpy(dst + i * sizeof(U), &u, sizeof(U));
+    }
+}
+
+template <typename U, typename T>
+static void Unpack(const unsigned char* src, size_t n, long long base, T* out) {
+    for (size_t i = 0; i < n; ++i) {
+        U u;
+        memcpy(&u, src + i * sizeof(U), sizeof(U));
+        out[i] = (T)(base + (long long)u);
+    }
+}
+
+template <typename T>
+static void PutColumn(std::vector<unsigned char>& out, const std::vector<T>& v) {
+    long long lo = (long long)v[0], hi = lo;
+    for (size_t i = 1; i < v.size(); ++i) {
+        if ((long long)v[i] < lo) lo = (long long)v[i];
+        if ((long long)v[i] > hi) hi = (long long)v[i];
+    }
+    unsigned long long range = (unsigned long long)hi - (unsigned long long)lo;
+    int width = range == 0 ? 0 : range <= 0xffULL ? 1 : range <= 0xffffULL ? 2 : range <= 0xffffffffULL ? 4 : 8;
+
+    size_t at = out.size();
+    out.resize(at + COLUMN_HEADER_SIZE + v.size() * width);
+    out[at] = (unsigned char)width;
+    PutLE(&out[at + 1], (unsigned long long)lo, 8);
+    unsigned char* dst = &out[at + COLUMN_HEADER_SIZE];
+    switch (width) {
+    case 1: Pack<unsigned char>(v, lo, dst); break;
+    case 2: Pack<unsigned short>(v, lo, dst); break;
+    case 4: Pack<unsigned int>(v, lo, dst); break;
+    case 8: Pack<unsigned long long>(v, lo, dst); break;
+    }
+}
+
+template <typename T>
+static bool GetColumn(const unsigned char* p, size_t size, size_t& pos, size_t n, std::vector<T>& out) {
+    if (pos + COLUMN_HEADER_SIZE > size) return false;
+    int width = p[pos];
+    long long base = (long long)GetLE(p + pos + 1, 8);
+    pos += COLUMN_HEADER_SIZE;
+    if (width != 0 && width != 1 && width != 2 && width != 4 && width != 8) return false;
+    if (pos + n * width > size) return false;
+
+    out.resize(n);
+    T* dst = n ? &out[0] : NULL;
+    switch (width) {
+    case 0: for (size_t i = 0; i < n; ++i) dst[i] = (T)base; break;
+    case 1: Unpack<unsigned char>(p + pos, n, base, dst); break;
+    case 2: Unpack<unsigned short>(p + pos, n, base, dst); break;
+    case 4: Unpack<unsigned int>(p + pos, n, base, dst); break;
+    case 8: Unpack<unsigned long long>(p + pos, n, base, dst); break;
+    }
+    pos += n * width;
+    return true;
+}
+
+void EncodeTrailChunk(const TrailColumns& cols, std::vector<unsigned char>& out) {
+    out.clear();
+    size_t n = cols.Size();
+    if (n == 0) return;
+
+    TrailChunkStats stats;
+    stats.t0 = cols.t[0];
+    stats.t1 = cols.last[n - 1];
+    stats.minX = stats.maxX = cols.x[0];
+    stats.minY = stats.maxY = cols.y[0];
+    stats.samples = 0;
+    stats.records = (unsigned int)n;
+    for (size_t i = 0; i < n; ++i) {
+        if (cols.x[i] < stats.minX) stats.minX = cols.x[i];
+        if (cols.x[i] > stats.maxX) stats.maxX = cols.x[i];
+        if (cols.y[i] < stats.minY) stats.minY = cols.y[i];
+        if (cols.y[i] > stats.maxY) stats.maxY = cols.y[i];
+        stats.samples += (unsigned long long)cols.count[i];
+    }
+
+    out.resize(TRAIL_CHUNK_STATS_SIZE);
+    PutLE(&out[0], (unsigned long long)stats.t0, 8);
+    PutLE(&out[8], (unsigned long long)stats.t1, 8);
+    PutLE(&out[16], (unsigned int)stats.minX, 4);
+    PutLE(&out[20], (unsigned int)stats.minY, 4);
+    PutLE(&out[24], (unsigned int)stats.maxX, 4);
+    PutLE(&out[28], (unsigned int)stats.maxY, 4);
+    PutLE(&out[32], stats.samples, 8);
+    PutLE(&out[40], stats.records, 4);
+    PutLE(&out[44], 0, 4);
+
+    // Gaps stay small where absolute times would need 8 bytes each
+    std::vector<long long> gaps(n);
+    gaps[0] = 0;
+    for (size_t i = 1; i < n; ++i) gaps[i] = cols.t[i] - cols.t[i - 1];
+
+    PutColumn(out, gaps);
+    PutColumn(out, cols.x);
+    PutColumn(out, cols.y);
+    PutColumn(out, cols.count);
+    PutColumn(out, cols.buttons);
+    PutColumn(out, cols.window);
+
+    std::vector<long long> spans(n);
+    for (size_t i = 0; i < n; ++i) spans[i] = cols.last[i] - cols.t[i];
+    PutColumn(out, spans);
+}
+
+bool DecodeTrailChunkStats(const unsigned char* p, size_t size, TrailChunkStats& stats) {
+    if (size < TRAIL_CHUNK_STATS_SIZE) return false;
+    stats.t0 = (long long)GetLE(p, 8);
+    stats.t1 = (long long)GetLE(p + 8, 8);
+    stats.minX = (int)(unsigned int)GetLE(p + 16, 4);
+    stats.minY = (int)(unsigned int)GetLE(p + 20, 4);
+    stats.maxX = (int)(unsigned int)GetLE(p + 24, 4);
+    stats.maxY = (int)(unsigned int)GetLE(p + 28, 4);
+    stats.samples = GetLE(p + 32, 8);
+    stats.records = (unsigned int)GetLE(p + 40, 4);
+    return true;
+}
+
+bool DecodeTrailChunk(const unsigned char* p, size_t size, TrailColumns& cols) {
+    TrailChunkStats stats;
+    if (!DecodeTrailChunkStats(p, size, stats)) return false;
+
+    size_t n = stats.records, pos = TRAIL_CHUNK_STATS_SIZE;
+    if (!GetColumn(p, size, pos, n, cols.t) || !GetColumn(p, size, pos, n, cols.x) ||
+        !GetColumn(p, size, pos, n, cols.y) || !GetColumn(p, size, pos, n, cols.count) ||
+        !GetColumn(p, size, pos, n, cols.buttons) || !GetColumn(p, size, pos, n, cols.window) ||
+        !GetColumn(p, size, pos, n, cols.last)) {
+        return false;
+    }
+
+    // Gaps back to times, spans to run ends
+    long long t = stats.t0;
+    for (size_t i = 0; i < n; ++i) {
+        t += cols.t[i];
+        cols.t[i] = t;
+        cols.last[i] += t;
+    }
+    return pos == size;
+}
@@ -0,0 +1,72 @@
+/*
+    Trail Columns
+    Column layout of the 'C' sample chunks in binary logs (LogFormat=columnar,
+    see trail_log.h). A chunk holds up to a few thousand records as separate
+    t, x, y, count, buttons, window and span columns, led by its stats:
+
+        stats   i64 t0, i64 t1 (end of the last run), i32 min x, i32 min y,
+                i32 max x, i32 max y, u64 samples, u32 records, u32 reserved
+        column  u8 width (0, 1, 2, 4 or 8), i64 base, records * width bytes
+
+    Each column stores value - base in a fixed width (frame of reference);
+    width 0 means every value equals base, as buttons and window usually do.
+    The t column holds the gap to the previous record (0 for the first, t0
+    is the stats' t0), span the time from a record's first to its last
+    sample. Fixed widths decode in plain widening loops with no per-value
+    branches, and a reader that only wants a time range or a region checks
+    the stats and skips the whole chunk without decoding it.
+
+    Fixed-width values are copied as-is, so like the ring file the layout
+    assumes a little-endian host.
+*/
+
+#ifndef TRAIL_COLUMNS_H
+#define TRAIL_COLUMNS_H
+
+#include <stddef.h>
+#include <vector>
+#include "trail_sample.h"
+
+static const unsigned int TRAIL_CHUNK_STATS_SIZE = 48;
+
+struct TrailChunkStats {
+    long long t0, t1;
+    int minX, minY, maxX, maxY;
+    unsigned long long samples; // Records weighted by their run length
+    unsigned int records;
+};
+
+// Time range (sample time, inclusive) and region (inclusive) a reader keeps;
+// a default filter keeps everything
+struct TrailChunkFilter {
+    long long fromT, toT;
+    int minX, minY, maxX, maxY;
+
+    TrailChunkFilter();
+    bool Overlaps(const TrailChunkStats& stats) const;
+    // runEnd is the time of the run's last sample
+    bool Contains(const TrailSample& s, long long runEnd) const;
+};
+
+// One chunk's records, one vector per column
+struct TrailColumns {
+    std::vector<long long> t, count;
+    std::vector<long long> last; // Run's last sample time (span column + t)
+    std::vector<int> x, y, window;
+    std::vector<unsigned int> buttons;
+
+    size_t Size() const { return t.size(); }
+    void Clear();
+    void Push(const TrailSample& s, long long runCount, long long runEnd);
+};
+
+// Stats + columns; t1 is the last record's run end
+void EncodeTrailChunk(const TrailColumns& cols, std::vector<unsigned char>& out);
+
+// The stats alone, from the first TRAIL_CHUNK_STATS_SIZE bytes of a chunk
+bool DecodeTrailChunkStats(const unsigned char* p, size_t size, TrailChunkStats& stats);
+
+// False if the payload doesn't match its own column sizes
+bool DecodeTrailChunk(const unsigned char* p, size_t size, TrailColumns& cols);
+
+#endif
@@ -0,0 +1,1283 @@
+#include "trail_log.h"
+#include "trail_clock.h"
+#include "trail_ring.h"
+#include "file_offset.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#include "uring_file.h"
+#endif
+
+// ReadPoints finds newlines 16 bytes per instruction where SSE2 is a given
+#if defined(__SSE2__) || defined(_M_X64)
+#define TRAIL_SSE2 1
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+static const char BINARY_MAGIC[4] = { 'M', 'T', 'R', 'B' };
+static const unsigned int BINARY_VERSION = 1;
+static const unsigned int HEADER_SIZE = 40;
+static const unsigned int BLOCK_HEADER_SIZE = 16;
+static const unsigned int MAX_BLOCK_PAYLOAD = 16 << 20; // Sanity limit for corrupt sizes
+
+static const unsigned int FOOTER_PAYLOAD = 24;
+
+static const unsigned long long TEXT_RECORD_BYTES = 20;  // "1234,567,123456789012345\n" is a bit more
+static const unsigned long long BINARY_RECORD_BYTES = 6; // Varint deltas, see EncodeRun
+static const size_t MIN_PART_BYTES = 1 << 20;            // ReadPoints: smaller parts aren't worth a thread
+static const int CANCEL_LINES = 4096;                    // ReadPoints: lines between cancel checks
+
+static const char INDEX_MAGIC[4] = { 'M', 'T', 'R', 'I' };
+static const unsigned int INDEX_VERSION = 1;
+static const unsigned int INDEX_HEADER_SIZE = 16;
+static const unsigned int INDEX_ENTRY_SIZE = 16;
+
+// Little-endian and varint helpers
+
+static void PutU16(unsigned char* p, unsigned int v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void PutU32(unsigned char* p, unsigned int v) {
+    for (int i = 0; i < 4; ++i) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void PutU64(unsigned char* p, unsigned long long v) {
+    for (int i = 0; i < 8; ++i) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static unsigned int GetU16(const unsigned char* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int GetU32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned long long GetU64(const unsigned char* p) {
+    unsigned long long v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+static void PutVarint(std::vector<unsigned char>& out, unsigned long long v) {
+    while (v >= 0x80) {
+        out.push_back((unsigned char)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((unsigned char)v);
+}
+
+static bool GetVarint(const unsigned char* in, size_t size, size_t& pos, unsigned long long& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && pos < size; shift += 7) {
+        unsigned char b = in[pos++];
+        v |= (unsigned long long)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+static unsigned long long ZigZag(long long v) {
+    return ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63);
+}
+
+static long long UnZigZag(unsigned long long v) {
+    return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+struct Crc32Table {
+    unsigned int v[256];
+    Crc32Table() {
+        for (unsigned int i = 0; i < 256; ++i) {
+            unsigned int c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            v[i] = c;
+        }
+    }
+};
+
+static unsigned int Crc32(const unsigned char* data, size_t len) {
+    static const Crc32Table table; // Built once, thread-safe
+
+    unsigned int crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i) crc = table.v[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+TrailFormat ParseTrailFormat(const char* name) {
+    if (name && strcmp(name, "binary") == 0) return TRAIL_FORMAT_BINARY;
+    if (name && strcmp(name, "columnar") == 0) return TRAIL_FORMAT_COLUMNAR;
+    return TRAIL_FORMAT_TEXT;
+}
+
+TrailDurability ParseTrailDurability(const char* name) {
+    if (name && strcmp(name, "batch") == 0) return TRAIL_SYNC_BATCH;
+    if (name && strcmp(name, "every") == 0) return TRAIL_SYNC_EVERY;
+    return TRAIL_SYNC_NONE;
+}
+
+// Text line scanner. Hand-rolled because sscanf was most of the time it
+// took to load a large log. Bounded = false skips the end checks, for text
+// known to have a newline ahead (which stops every loop here).
+
+template <bool Bounded>
+static bool ScanNumber(const char*& p, const char* end, long long& v) {
+    while ((!Bounded || p < end) && (*p == ' ' || *p == '\t')) ++p;
+    if (Bounded && p >= end) return false;
+    bool negative = *p == '-';
+    if (*p == '-' || *p == '+') ++p;
+    if ((Bounded && p >= end) || (unsigned)(*p - '0') > 9) return false;
+
+    unsigned long long u = 0;
+    unsigned int digit;
+    while ((!Bounded || p < end) && (digit = (unsigned)(*p - '0')) <= 9) {
+        u = u * 10 + digit;
+        ++p;
+    }
+    v = negative ? -(long long)u : (long long)u;
+    return true;
+}
+
+// x,y[,t[,n[,buttons,window[,last]]]]; p is left where the numbers end.
+// last is 0 when the line doesn't have it.
+template <bool Bounded>
+static bool ScanTrailLine(const char*& p, const char* end, TrailSample& s, long long& count, long long& last) {
+    if ((Bounded && p >= end) || *p == '#') return false;
+
+    long long v[7];
+    int fields = 0;
+    while (fields < 7 && ScanNumber<Bounded>(p, end, v[fields])) {
+        fields++;
+        if ((Bounded && p >= end) || *p != ',') break;
+        ++p;
+    }
+    if (fields < 2) return false;
+
+    s.x = (int)v[0];
+    s.y = (int)v[1];
+    s.t = fields > 2 ? v[2] : 0;
+    count = fields > 3 ? v[3] : 1;
+    s.buttons = fields > 4 ? (unsigned int)v[4] : 0;
+    s.window = fields > 5 ? (int)v[5] : 0;
+    last = fields > 6 ? v[6] : 0;
+    if (count < 1) count = 1;
+    return true;
+}
+
+// Writer
+
+TrailWriter::TrailWriter()
+    : m_file(NULL), m_sessionStart(0), m_format(TRAIL_FORMAT_TEXT), m_runCount(0), m_runEnd(0), m_samples(0), m_records(0),
+      m_commitSamples(1000), m_commitNs(1000000000LL), m_durability(TRAIL_SYNC_NONE),
+      m_uncommitted(0), m_lastCommit(0), m_commits(0), m_syncs(0),
+      m_blockRecords(0), m_prevDt(0),
+      m_index(NULL), m_indexEvery(0), m_sinceIndex(0), m_blockIndexed(false), m_blockT(0) {}
+
+TrailWriter::~TrailWriter() {
+    Close();
+}
+
+void TrailWriter::SetCommitPolicy(int maxSamples, int maxMs, TrailDurability durability) {
+    m_commitSamples = maxSamples > 0 ? maxSamples : 1;
+    m_commitNs = (long long)(maxMs > 0 ? maxMs : 0) * 1000000LL;
+    m_durability = durability;
+}
+
+void TrailWriter::Open(FILE* f, int intervalMs, TrailFormat format, int screenW, int screenH) {
+    Close();
+    m_file = f;
+    m_format = format;
+    m_runCount = 0;
+    m_samples = 0;
+    m_records = 0;
+    m_uncommitted = 0;
+    m_lastCommit = GetMonotonicNs();
+    m_commits = 0;
+    m_syncs = 0;
+    m_block.clear();
+    m_blockRecords = 0;
+    m_blockIndexed = false;
+    m_columns.Clear();
+
+    // Big enough that stdio never writes on its own between group commits.
+    // glibc ignores the size unless it is given the buffer too.
+    m_stdioBuffer.resize(STDIO_BUFFER);
+    setvbuf(m_file, &m_stdioBuffer[0], _IOFBF, STDIO_BUFFER);
+    SeekFile64(m_file, 0, SEEK_END); // The tell gives real offsets for the index, also in "a" mode
+    m_sessionStart = TellFile64(m_file);
+
+    // Read both clocks back to back so the anchor pair is as tight as possible
+    long long mono = GetMonotonicNs();
+    long long wall = GetWallClockNs();
+
+    if (m_format != TRAIL_FORMAT_TEXT) {
+        unsigned char h[HEADER_SIZE];
+        memcpy(h, BINARY_MAGIC, 4);
+        PutU16(h + 4, BINARY_VERSION);
+        PutU16(h + 6, HEADER_SIZE);
+        PutU32(h + 8, (unsigned int)screenW);
+        PutU32(h + 12, (unsigned int)screenH);
+        PutU32(h + 16, (unsigned int)intervalMs);
+        PutU32(h + 20, 0);
+        PutU64(h + 24, (unsigned long long)wall);
+        PutU64(h + 32, (unsigned long long)mono);
+        fwrite(h, 1, sizeof(h), m_file);
+        return;
+    }
+
+    fprintf(m_file, "# session wall_ns=%lld mono_ns=%lld interval_ms=%d", wall, mono, intervalMs);
+    if (screenW > 0 && screenH > 0) fprintf(m_file, " screen=%dx%d", screenW, screenH);
+    fprintf(m_file, "\n");
+}
+
+void TrailWriter::OpenIndex(FILE* idx, int everySamples) {
+    if (m_index) fclose(m_index);
+    m_index = idx;
+    m_indexEvery = everySamples > 0 ? everySamples : 0;
+    m_sinceIndex = m_indexEvery; // First record gets an entry
+    if (!m_index) return;
+
+    SeekFile64(m_index, 0, SEEK_END);
+    if (TellFile64(m_index) == 0) {
+        unsigned char h[INDEX_HEADER_SIZE];
+        memcpy(h, INDEX_MAGIC, 4);
+        PutU16(h + 4, INDEX_VERSION);
+        PutU16(h + 6, INDEX_ENTRY_SIZE);
+        PutU32(h + 8, (unsigned int)m_indexEvery);
+        PutU32(h + 12, 0);
+        fwrite(h, 1, sizeof(h), m_index);
+    }
+}
+
+// Points at the next byte written to the log
+void TrailWriter::WriteIndexEntry(long long t) {
+    unsigned char e[INDEX_ENTRY_SIZE];
+    PutU64(e, (unsigned long long)t);
+    PutU64(e + 8, (unsigned long long)TellFile64(m_file));
+    fwrite(e, 1, sizeof(e), m_index);
+}
+
+void TrailWriter::Append(const TrailSample& s) {
+    if (!m_file) return;
+    m_samples++;
+    m_uncommitted++;
+
+    if (m_runCount > 0 && s.x == m_run.x && s.y == m_run.y &&
+        s.buttons == m_run.buttons && s.window == m_run.window) {
+        m_runCount++;
+        m_runEnd = s.t;
+        return;
+    }
+
+    WriteRun();
+    m_run = s;
+    m_runCount = 1;
+    m_runEnd = s.t;
+}
+
+void TrailWriter::WriteRun() {
+    if (m_runCount == 0) return;
+
+    // Binary blocks are the unit a reader can start from, so only a block's first record is indexed
+    if (m_index && m_indexEvery > 0 && m_sinceIndex >= m_indexEvery &&
+        (m_format == TRAIL_FORMAT_TEXT || m_blockRecords == 0)) {
+        if (m_format != TRAIL_FORMAT_TEXT) {
+            m_blockIndexed = true;
+            m_blockT = m_run.t;
+        } else {
+            WriteIndexEntry(m_run.t);
+        }
+        m_sinceIndex = 0;
+    }
+    m_sinceIndex += m_runCount;
+
+    if (m_format != TRAIL_FORMAT_TEXT) {
+        EncodeRun();
+    } else if (m_runCount > 1) {
+        fprintf(m_file, "%d,%d,%lld,%lld,%u,%d,%lld\n", m_run.x, m_run.y, m_run.t, m_runCount,
+                m_run.buttons, m_run.window, m_runEnd);
+    } else if (m_run.buttons || m_run.window) {
+        fprintf(m_file, "%d,%d,%lld,%lld,%u,%d\n", m_run.x, m_run.y, m_run.t, m_runCount,
+                m_run.buttons, m_run.window);
+    }
+    else fprintf(m_file, "%d,%d,%lld\n", m_run.x, m_run.y, m_run.t);
+    m_records++;
+    m_runCount = 0;
+}
+
+void TrailWriter::EncodeRun() {
+    if (m_format == TRAIL_FORMAT_COLUMNAR) {
+        m_columns.Push(m_run, m_runCount, m_runEnd);
+        if (++m_blockRecords >= (unsigned int)CHUNK_RECORDS) FlushBlock();
+        return;
+    }
+
+    if (m_blockRecords == 0) {
+        m_prev.x = m_prev.y = 0;
+        m_prev.t = 0;
+        m_prevDt = 0;
+    }
+
+    long long dt = m_run.t - m_prev.t;
+    PutVarint(m_block, ZigZag((long long)m_run.x - m_prev.x));
+    PutVarint(m_block, ZigZag((long long)m_run.y - m_prev.y));
+    PutVarint(m_block, ZigZag(dt - m_prevDt));
+
+    bool extra = m_run.buttons || m_run.window;
+    PutVarint(m_block, ((unsigned long long)m_runCount << 1) | (extra ? 1 : 0));
+    if (extra) {
+        PutVarint(m_block, m_run.buttons);
+        PutVarint(m_block, (unsigned long long)m_run.window);
+    }
+    if (m_runCount > 1) PutVarint(m_block, (unsigned long long)(m_runEnd - m_run.t));
+
+    // The block's first record carries absolute t, deltas start after it
+    m_prevDt = m_blockRecords == 0 ? 0 : dt;
+    m_prev = m_run;
+    if (++m_blockRecords >= (unsigned int)BLOCK_RECORDS) FlushBlock();
+}
+
+void TrailWriter::WriteBlock(char type, unsigned int count, const std::vector<unsigned char>& payload) {
+    unsigned char h[BLOCK_HEADER_SIZE];
+    memset(h, 0, sizeof(h));
+    h[0] = (unsigned char)type;
+    PutU32(h + 4, count);
+    PutU32(h + 8, (unsigned int)payload.size());
+    PutU32(h + 12, Crc32(payload.empty() ? NULL : &payload[0], payload.size()));
+    fwrite(h, 1, sizeof(h), m_file);
+    if (!payload.empty()) fwrite(&payload[0], 1, payload.size(), m_file);
+}
+
+void TrailWriter::FlushBlock() {
+    if (m_blockRecords == 0) return;
+    if (m_blockIndexed) WriteIndexEntry(m_blockT);
+    m_blockIndexed = false;
+    if (m_format == TRAIL_FORMAT_COLUMNAR) {
+        EncodeTrailChunk(m_columns, m_block);
+        m_columns.Clear();
+    }
+    WriteBlock(m_format == TRAIL_FORMAT_COLUMNAR ? 'C' : 'S', m_blockRecords, m_block);
+    m_block.clear();
+    m_blockRecords = 0;
+}
+
+void TrailWriter::WriteWindow(int id, unsigned long long handle, const char* name) {
+    if (!m_file) return;
+    if (!name) name = "";
+
+    if (m_format != TRAIL_FORMAT_TEXT) {
+        // Goes out ahead of the open sample block, so it still precedes its first use
+        std::vector<unsigned char> payload;
+        size_t len = strlen(name);
+        PutVarint(payload, (unsigned long long)id);
+        PutVarint(payload, handle);
+        PutVarint(payload, len);
+        payload.insert(payload.end(), name, name + len);
+        WriteBlock('W', 1, payload);
+        return;
+    }
+
+    fprintf(m_file, "# window %d 0x%llx %s\n", id, handle, name);
+}
+
+void TrailWriter::Flush() {
+    if (!m_file) return;
+
+    if (m_durability == TRAIL_SYNC_EVERY ||
+        m_uncommitted >= m_commitSamples ||
+        GetMonotonicNs() - m_lastCommit >= m_commitNs) {
+        Commit();
+    }
+}
+
+void TrailWriter::Commit() {
+    if (!m_file) return;
+
+    // The held-back run goes out as far as it got, so a crash during a long
+    // park doesn't lose it; further repeats start a new record
+    WriteRun();
+    if (m_format != TRAIL_FORMAT_TEXT) FlushBlock();
+    fflush(m_file);
+    if (m_index) fflush(m_index); // After the log, so entries never point past it
+    if (m_durability != TRAIL_SYNC_NONE) Sync();
+
+    m_uncommitted = 0;
+    m_lastCommit = GetMonotonicNs();
+    m_commits++;
+}
+
+void TrailWriter::Sync() {
+#ifdef _WIN32
+    _commit(_fileno(m_file));
+#else
+    if (!SyncUringFile(m_file)) fdatasync(fileno(m_file)); // An io_uring log has no fd of its own
+#endif
+    m_syncs++;
+}
+
+// Last bytes of the session, so a reader finds its start from the end of the file
+void TrailWriter::WriteFooter() {
+    if (m_format != TRAIL_FORMAT_TEXT) {
+        std::vector<unsigned char> payload(FOOTER_PAYLOAD);
+        PutU64(&payload[0], (unsigned long long)m_sessionStart);
+        PutU64(&payload[8], m_samples);
+        PutU64(&payload[16], m_records);
+        WriteBlock('E', 0, payload);
+        return;
+    }
+    fprintf(m_file, "# end start=%lld samples=%llu records=%llu\n", m_sessionStart, m_samples, m_records);
+}
+
+void TrailWriter::Close() {
+    if (!m_file) return;
+    WriteRun();
+    if (m_format != TRAIL_FORMAT_TEXT) FlushBlock();
+    WriteFooter();
+    fflush(m_file);
+    if (m_durability != TRAIL_SYNC_NONE) Sync();
+    fclose(m_file);
+    m_file = NULL;
+    if (m_index) fclose(m_index);
+    m_index = NULL;
+}
+
+// Reader
+
+TrailReader::TrailReader()
+    : m_file(NULL), m_binary(false), m_ring(false), m_intervalMs(0), m_screenW(0), m_screenH(0),
+      m_wallNs(0), m_monoNs(0), m_badBlocks(0), m_payload(NULL), m_payloadSize(0),
+      m_pos(0), m_left(0), m_decoded(0), m_prevDt(0), m_chunk(false), m_runEnd(0),
+      m_ringCapacity(0), m_ringEpoch(0), m_ringNext(0), m_ringEnd(0), m_ringPos(0), m_mapPos(0), m_textTerminated(0), m_indexSorted(false), m_seekT(0),
+      m_filtered(false), m_skippedChunks(0), m_marked(false), m_markOffset(0), m_markSeekT(0), m_markIntervalMs(0) {}
+
+TrailReader::~TrailReader() {
+    Close();
+}
+
+bool TrailReader::Open(FILE* f) {
+    Close();
+    if (!f) return false;
+    m_file = f;
+    m_windows.clear();
+    m_badBlocks = 0;
+    m_left = 0;
+    m_index.clear();
+    m_seekT = 0;
+    m_filter = TrailChunkFilter();
+    m_filtered = false;
+    m_skippedChunks = 0;
+    m_marked = false;
+
+    char magic[4];
+    bool hasMagic = fread(magic, 1, 4, m_file) == 4;
+    m_binary = hasMagic && memcmp(magic, BINARY_MAGIC, 4) == 0;
+    m_ring = hasMagic && memcmp(magic, RING_MAGIC, 4) == 0;
+    SeekFile64(m_file, 0, SEEK_SET);
+    if (m_ring && !OpenRing()) {
+        Close();
+        return false;
+    }
+
+    // Anchors of the first session are known before the first Next()
+    if (!m_ring) {
+        char line[512];
+        if (m_binary) ReadHeader();
+        else if (fgets(line, sizeof(line), m_file)) ReadSessionLine(line);
+        SeekFile64(m_file, 0, SEEK_SET);
+    }
+    m_mapPos = 0;
+    m_textTerminated = 0;
+    if (m_ring || !m_map.OpenRead(m_file)) return true; // Not mappable (a pipe): fgets / fread instead
+    if (!m_binary) {
+        const char* base = (const char*)m_map.Data();
+        size_t n = m_map.Size();
+        while (n > 0 && base[n - 1] != '\n') --n;
+        m_textTerminated = n;
+    }
+    return true;
+}
+
+bool TrailReader::OpenRing() {
+    TrailRingHeader h;
+    if (fread(&h, sizeof(h), 1, m_file) != 1) return false;
+    if (h.version != RING_VERSION || h.recordSize != sizeof(TrailRingRecord) ||
+        h.capacity == 0 || h.head < h.tail) return false;
+
+    m_intervalMs = h.intervalMs;
+    m_screenW = h.screenW;
+    m_screenH = h.screenH;
+    m_wallNs = h.wallNs;
+    m_monoNs = h.monoNs;
+    m_ringCapacity = h.capacity;
+    m_ringEpoch = h.epoch;
+    m_ringNext = h.tail;
+    m_ringEnd = h.head;
+    m_ringChunk.clear();
+    m_ringPos = 0;
+    return true;
+}
+
+void TrailReader::Close() {
+    if (!m_file) return;
+    m_map.Close();
+    fclose(m_file);
+    m_file = NULL;
+}
+
+bool TrailReader::OpenIndex(FILE* idx) {
+    m_index.clear();
+    if (!idx) return false;
+
+    unsigned char h[INDEX_HEADER_SIZE];
+    bool ok = fread(h, 1, sizeof(h), idx) == sizeof(h) && memcmp(h, INDEX_MAGIC, 4) == 0 &&
+              GetU16(h + 6) == INDEX_ENTRY_SIZE;
+    unsigned char e[INDEX_ENTRY_SIZE];
+    while (ok && fread(e, 1, sizeof(e), idx) == sizeof(e)) {
+        IndexEntry entry;
+        entry.t = (long long)GetU64(e);
+        entry.offset = GetU64(e + 8);
+        m_index.push_back(entry);
+    }
+    fclose(idx);
+
+    // Sessions from another boot restart the clock; such an index can't be searched
+    m_indexSorted = true;
+    for (size_t i = 1; i < m_index.size(); ++i) {
+        if (m_index[i].t < m_index[i - 1].t) m_indexSorted = false;
+    }
+    return ok;
+}
+
+bool TrailReader::SeekToTime(long long t) {
+    if (!m_file) return false;
+    m_seekT = t;
+    if (m_ring) return SeekRing(t);
+    if (!m_indexSorted || m_index.empty() || t <= m_index[0].t) return false;
+
+    // Last entry at or before t
+    size_t lo = 0, hi = m_index.size();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (m_index[mid].t <= t) lo = mid;
+        else hi = mid;
+    }
+    if (!SeekFile((long long)m_index[lo].offset)) {
+        SeekFile(0);
+        return false;
+    }
+    m_left = 0;
+    return true;
+}
+
+void TrailReader::SetFilter(const TrailChunkFilter& filter) {
+    m_filter = filter;
+    m_filtered = true;
+}
+
+bool TrailReader::SeekToLastSession() {
+    if (!m_file) return false;
+    if (m_ring) return m_monoNs != 0 && SeekRing(m_monoNs); // The header anchors the latest session
+    if (SeekFile64(m_file, 0, SEEK_END) != 0) return false;
+    long long size = TellFile64(m_file);
+    long long start = -1;
+
+    if (m_binary) {
+        unsigned char f[BLOCK_HEADER_SIZE + FOOTER_PAYLOAD];
+        if (size >= (long long)sizeof(f) && SeekFile64(m_file, size - (long long)sizeof(f), SEEK_SET) == 0 &&
+            fread(f, 1, sizeof(f), m_file) == sizeof(f) && f[0] == 'E' && GetU32(f + 8) == FOOTER_PAYLOAD &&
+            Crc32(f + BLOCK_HEADER_SIZE, FOOTER_PAYLOAD) == GetU32(f + 12)) {
+            start = (long long)GetU64(f + BLOCK_HEADER_SIZE);
+        } else if (!FindLastSessionBinary(start)) {
+            start = -1;
+        }
+    } else if (!FindLastSessionText(start)) {
+        start = -1;
+    }
+
+    // The session must begin with its header
+    char magic[10];
+    size_t want = m_binary ? 4 : 10;
+    if (start < 0 || start >= size || SeekFile64(m_file, start, SEEK_SET) != 0 ||
+        fread(magic, 1, want, m_file) != want ||
+        memcmp(magic, m_binary ? BINARY_MAGIC : "# session ", want) != 0) {
+        SeekFile(0);
+        return false;
+    }
+    SeekFile(start);
+    m_left = 0;
+    return true;
+}
+
+// Moves both the FILE and the mapped position
+bool TrailReader::SeekFile(long long offset) {
+    m_mapPos = (size_t)offset;
+    return SeekFile64(m_file, offset, SEEK_SET) == 0;
+}
+
+bool TrailReader::SetMark() {
+    if (!m_file || (m_binary && m_left != 0)) return false;
+    if (m_ring) {
+        m_markOffset = (long long)(m_ringNext - (m_ringChunk.size() - m_ringPos));
+    } else {
+        m_markOffset = m_map.IsOpen() ? (long long)m_mapPos : TellFile64(m_file);
+        if (m_markOffset < 0) return false;
+    }
+    m_markSeekT = m_seekT;
+    m_markIntervalMs = m_intervalMs;
+    m_marked = true;
+    return true;
+}
+
+bool TrailReader::ReturnToMark() {
+    if (!m_file || !m_marked) return false;
+    m_seekT = m_markSeekT;
+    m_intervalMs = m_markIntervalMs;
+    m_left = 0;
+    if (m_ring) {
+        m_ringNext = (unsigned long long)m_markOffset;
+        m_ringChunk.clear();
+        m_ringPos = 0;
+        return true;
+    }
+    return SeekFile(m_markOffset);
+}
+
+unsigned long long TrailReader::EstimateRecords() {
+    if (!m_file) return 0;
+    if (m_ring) return m_ringEnd - m_ringNext + (m_ringChunk.size() - m_ringPos);
+    if (m_map.IsOpen()) {
+        size_t left = m_mapPos < m_map.Size() ? m_map.Size() - m_mapPos : 0;
+        return left / (m_binary ? BINARY_RECORD_BYTES : TEXT_RECORD_BYTES);
+    }
+
+    long long pos = TellFile64(m_file);
+    if (pos < 0 || SeekFile64(m_file, 0, SEEK_END) != 0) return 0;
+    long long size = TellFile64(m_file);
+    SeekFile64(m_file, pos, SEEK_SET);
+    return (unsigned long long)(size - pos) / (m_binary ? BINARY_RECORD_BYTES : TEXT_RECORD_BYTES);
+}
+
+// No footer (crashed session): hop from block header to block header, no payload is read
+bool TrailReader::FindLastSessionBinary(long long& start) {
+    start = -1;
+    SeekFile64(m_file, 0, SEEK_SET);
+    for (;;) {
+        long long pos = TellFile64(m_file);
+        unsigned char h[BLOCK_HEADER_SIZE];
+        if (fread(h, 1, 8, m_file) != 8) break;
+
+        if (memcmp(h, BINARY_MAGIC, 4) == 0) {
+            start = pos;
+            if (SeekFile64(m_file, pos + GetU16(h + 6), SEEK_SET) != 0) break;
+            continue;
+        }
+        if (fread(h + 8, 1, BLOCK_HEADER_SIZE - 8, m_file) != BLOCK_HEADER_SIZE - 8) break;
+        unsigned int size = GetU32(h + 8);
+        if (size > MAX_BLOCK_PAYLOAD || SeekFile64(m_file, size, SEEK_CUR) != 0) break;
+    }
+    return start >= 0;
+}
+
+// The footer on the last line, or else (a crashed session) the last header
+bool TrailReader::FindLastSessionText(long long& start) {
+    static const long long CHUNK = 64 * 1024;
+    static const char HEADER[] = "# session ";
+    static const long long HEADER_LEN = sizeof(HEADER) - 1;
+
+    SeekFile64(m_file, 0, SEEK_END);
+    long long end = TellFile64(m_file);
+    std::vector<char> buf;
+
+    for (long long pos = end; pos > 0;) {
+        long long from = pos > CHUNK ? pos - CHUNK : 0;
+        long long to = pos + HEADER_LEN < end ? pos + HEADER_LEN : end; // A header can straddle chunks
+        buf.resize((size_t)(to - from));
+        if (SeekFile64(m_file, from, SEEK_SET) != 0 || fread(&buf[0], 1, buf.size(), m_file) != buf.size()) {
+            return false;
+        }
+
+        if (pos == end) {
+            size_t n = buf.size();
+            while (n > 0 && (buf[n - 1] == '\n' || buf[n - 1] == '\r')) --n;
+            size_t line = n;
+            while (line > 0 && buf[line - 1] != '\n') --line;
+            std::string last(buf.begin() + line, buf.begin() + n);
+            if (sscanf(last.c_str(), "# end start=%lld", &start) == 1) return true;
+        }
+
+        for (long long i = (long long)buf.size() - HEADER_LEN; i >= 0; --i) {
+            bool lineStart = i == 0 ? from == 0 : buf[i - 1] == '\n'; // i == 0 of a later chunk is rechecked in the earlier one
+            if (lineStart && memcmp(&buf[i], HEADER, HEADER_LEN) == 0) {
+                start = from + i;
+                return true;
+            }
+        }
+        pos = from;
+    }
+    return false;
+}
+
+// Records of a ring's current epoch (one boot) are in time order, so no index needed
+bool TrailReader::SeekRing(long long t) {
+    unsigned long long first = m_ringEpoch > m_ringNext ? m_ringEpoch : m_ringNext;
+    unsigned long long lo = first, hi = m_ringEnd; // First record with time >= t is in [lo, hi]
+    while (lo < hi) {
+        unsigned long long mid = lo + (hi - lo) / 2;
+        TrailRingRecord r;
+        if (SeekFile64(m_file, (long long)(RING_HEADER_SIZE + (mid % m_ringCapacity) * sizeof(r)), SEEK_SET) != 0 ||
+            fread(&r, sizeof(r), 1, m_file) != 1) {
+            return false;
+        }
+        if (r.t < t) lo = mid + 1;
+        else hi = mid;
+    }
+    // Step back one so a run that started earlier and still covers t is kept
+    m_ringNext = lo > first ? lo - 1 : lo;
+    m_ringChunk.clear();
+    m_ringPos = 0;
+    return true;
+}
+
+const char* TrailReader::GetWindowName(int id) const {
+    if (id < 1 || id > (int)m_windows.size()) return "";
+    return m_windows[id - 1].c_str();
+}
+
+void TrailReader::SetWindow(int id, const char* name) {
+    if (id < 1) return;
+    if ((size_t)id > m_windows.size()) m_windows.resize(id);
+    m_windows[id - 1] = name;
+}
+
+bool TrailReader::Next(TrailSample& s, long long& count) {
+    if (!m_file) return false;
+    for (;;) {
+        bool ok;
+        if (m_ring) ok = NextRing(s, count);
+        else if (m_binary) ok = NextBinary(s, count);
+        else ok = m_map.IsOpen() ? NextMapped(s, count) : NextText(s, count);
+        if (!ok) return false;
+
+        // Text lines without last: assume evenly spaced samples
+        if (m_runEnd < s.t) m_runEnd = s.t + (count - 1) * (long long)m_intervalMs * 1000000LL;
+        if (m_filtered && !m_filter.Contains(s, m_runEnd)) continue;
+
+        // Until SeekToTime's target is reached; the run covering it still counts
+        if (m_seekT == 0) return true;
+        if (m_runEnd < m_seekT) continue;
+        m_seekT = 0;
+        return true;
+    }
+}
+
+// Oldest to newest; a chunk never crosses the wrap point
+bool TrailReader::NextRing(TrailSample& s, long long& count) {
+    if (m_ringPos >= m_ringChunk.size()) {
+        if (m_ringNext >= m_ringEnd) return false;
+
+        unsigned long long slot = m_ringNext % m_ringCapacity;
+        unsigned long long n = m_ringEnd - m_ringNext;
+        if (n > m_ringCapacity - slot) n = m_ringCapacity - slot;
+        if (n > 4096) n = 4096;
+
+        m_ringChunk.resize((size_t)n);
+        if (SeekFile64(m_file, (long long)(RING_HEADER_SIZE + slot * sizeof(TrailRingRecord)), SEEK_SET) != 0 ||
+            fread(&m_ringChunk[0], sizeof(TrailRingRecord), (size_t)n, m_file) != n) {
+            return false;
+        }
+        m_ringNext += n;
+        m_ringPos = 0;
+    }
+
+    const TrailRingRecord& r = m_ringChunk[m_ringPos++];
+    s.t = r.t;
+    s.x = r.x;
+    s.y = r.y;
+    s.buttons = r.buttons;
+    s.window = 0;
+    count = r.count > 0 ? r.count : 1;
+    m_runEnd = r.last;
+    return true;
+}
+
+bool TrailReader::NextText(TrailSample& s, long long& count) {
+    char line[512];
+    while (fgets(line, sizeof(line), m_file)) {
+        if (ParseTrailLine(line, s, count, &m_runEnd)) return true;
+
+        int id;
+        unsigned long long handle;
+        char name[256];
+        if (ParseWindowLine(line, id, handle, name, sizeof(name))) {
+            SetWindow(id, name);
+        } else {
+            ReadSessionLine(line);
+        }
+    }
+    return false;
+}
+
+// One line at a time straight from the mapping, no copy except for '#' lines
+bool TrailReader::NextMapped(TrailSample& s, long long& count) {
+    const char* base = (const char*)m_map.Data();
+    const char* end = base + m_map.Size();
+    while (m_mapPos < m_map.Size()) {
+        const char* line = base + m_mapPos;
+
+        // Samples: the scan already stops at (or right before) the newline
+        if (*line != '#') {
+            const char* p = line;
+            bool ok;
+            if (m_mapPos < m_textTerminated) {
+                ok = ScanTrailLine<false>(p, end, s, count, m_runEnd);
+                while (*p != '\n') ++p;
+            } else {
+                ok = ScanTrailLine<true>(p, end, s, count, m_runEnd); // Unterminated last line
+                while (p < end && *p != '\n') ++p;
+            }
+            m_mapPos = p < end ? (size_t)(p - base) + 1 : m_map.Size();
+            if (ok) return true;
+            continue;
+        }
+
+        const char* nl = (const char*)memchr(line, '\n', end - line);
+        if (!nl) nl = end;
+        m_mapPos = nl < end ? (size_t)(nl - base) + 1 : m_map.Size();
+
+        char meta[512];
+        size_t len = (size_t)(nl - line) < sizeof(meta) - 1 ? (size_t)(nl - line) : sizeof(meta) - 1;
+        memcpy(meta, line, len);
+        meta[len] = 0;
+        int id;
+        unsigned long long handle;
+        char name[256];
+        if (ParseWindowLine(meta, id, handle, name, sizeof(name))) SetWindow(id, name);
+        else ReadSessionLine(meta);
+    }
+    return false;
+}
+
+// ScanNumber narrowed to an int, with the usual line (digits straight
+// away) in 32 bits. Unsigned wraparound gives the same int as the 64-bit
+// scan would; blanks and '+' go through ScanNumber itself.
+template <bool Bounded>
+static bool ScanInt(const char*& p, const char* end, int& v) {
+    const char* q = p;
+    bool negative = (!Bounded || q < end) && *q == '-';
+    if (negative) ++q;
+    unsigned int digit;
+    if ((Bounded && q >= end) || (digit = (unsigned)(*q - '0')) > 9) {
+        long long wide;
+        if (!ScanNumber<Bounded>(p, end, wide)) return false;
+        v = (int)wide;
+        return true;
+    }
+
+    unsigned int u = 0;
+    do {
+        u = u * 10 + digit;
+        ++q;
+    } while ((!Bounded || q < end) && (digit = (unsigned)(*q - '0')) <= 9);
+    v = (int)(negative ? 0u - u : u);
+    p = q;
+    return true;
+}
+
+// Just x,y of a sample line (what ScanTrailLine would give for them)
+template <bool Bounded>
+static bool ScanPoint(const char* p, const char* end, TrailPoint& pt) {
+    if ((Bounded && p >= end) || *p == '#' || !ScanInt<Bounded>(p, end, pt.x)) return false;
+    if ((Bounded && p >= end) || *p != ',') return false;
+    ++p;
+    return ScanInt<Bounded>(p, end, pt.y);
+}
+
+#ifdef TRAIL_SSE2
+// A bit per byte of p[0..63], set where it is a newline
+static unsigned long long NewlineMask(const char* p) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    unsigned long long mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+        mask |= (unsigned long long)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << (16 * i);
+    }
+    return mask;
+}
+
+static int LowestBit(unsigned long long mask) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward64(&i, mask);
+    return (int)i;
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+// The 1-7 digits p starts with, all eight bytes at once: a loop per digit
+// mispredicts on every number's length. 0 (take the byte loop) when p
+// doesn't start with a digit or has 8 or more.
+static int ScanDigits8(const char* p, unsigned int& v) {
+    unsigned long long w;
+    memcpy(&w, p, 8);
+    w -= 0x3030303030303030ULL; // Bytes past the first non-digit may borrow, they're shifted out
+    unsigned long long nondigit = ((w + 0x7676767676767676ULL) | w) & 0x8080808080808080ULL;
+    if (nondigit == 0) return 0;
+    int len = LowestBit(nondigit) / 8;
+    if (len == 0) return 0;
+
+    // First digit in the lowest byte; shifting left pads with leading zeros
+    w <<= 64 - 8 * len;
+    w = (w * 2561) >> 8 & 0x00FF00FF00FF00FFULL;          // Pairs: 10 * a + b
+    w = (w * 6553601) >> 16 & 0x0000FFFF0000FFFFULL;      // Fours: 100 * ab + cd
+    v = (unsigned int)((w * 42949672960001ULL) >> 32);    // 10000 * abcd + efgh
+    return len;
+}
+
+// ScanPoint for a line with 16 bytes of mapping after its start
+static bool ScanPoint16(const char* p, const char* end, TrailPoint& pt) {
+    unsigned int x, y;
+    int n = ScanDigits8(p, x);
+    if (n == 0 || p[n] != ',') return ScanPoint<false>(p, end, pt); // Signs, blanks, '#' lines
+    int m = ScanDigits8(p + n + 1, y);
+    if (m == 0) return ScanPoint<false>(p, end, pt);
+    pt.x = (int)x;
+    pt.y = (int)y;
+    return true;
+}
+#endif
+
+// Just past the next newline, which must come before end. Eight bytes at a
+// time: a sample's tail is too short for memchr's setup to pay off.
+static const char* SkipLine(const char* p, const char* end) {
+    const unsigned long long ones = 0x0101010101010101ULL, highs = 0x8080808080808080ULL;
+    while (end - p >= 8) {
+        unsigned long long v;
+        memcpy(&v, p, 8);
+        v ^= ones * '\n';
+        if ((v - ones) & ~v & highs) break; // A newline in these eight
+        p += 8;
+    }
+    while (*p != '\n') ++p;
+    return p + 1;
+}
+
+// Filling a big point vector is mostly page faults; where the kernel has
+// transparent huge pages, ask for them over the reserve (only a hint)
+static void ReservePoints(std::vector<TrailPoint>& points, size_t n) {
+    points.reserve(n);
+#ifdef MADV_HUGEPAGE
+    const uintptr_t HUGE_PAGE = 2 << 20;
+    uintptr_t from = ((uintptr_t)points.data() + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+    uintptr_t to = (uintptr_t)(points.data() + points.capacity()) & ~(HUGE_PAGE - 1);
+    if (to > from) madvise((void*)from, to - from, MADV_HUGEPAGE);
+#endif
+}
+
+// Positions from the lines in [p, end); a newline ends every line before terminated.
+// The rest of a line (time, run) isn't parsed, just skipped.
+static void ScanPoints(const char* p, const char* end, const char* terminated, std::vector<TrailPoint>* points,
+                       const std::atomic<bool>* cancel) {
+    TrailPoint pt;
+    ReservePoints(*points, (size_t)((end - p) / TEXT_RECORD_BYTES));
+    int lines = 0;
+#ifdef TRAIL_SSE2
+    // One pass over 64-byte blocks: every newline found ends the line that
+    // starts at line. What's left after the last whole block goes below.
+    const char* line = p;
+    for (; terminated - p >= 64; p += 64) {
+        for (unsigned long long mask = NewlineMask(p); mask != 0; mask &= mask - 1) {
+            if (cancel && ++lines == CANCEL_LINES) {
+                if (cancel->load(std::memory_order_relaxed)) return;
+                lines = 0;
+            }
+            if (end - line >= 16 ? ScanPoint16(line, end, pt) : ScanPoint<false>(line, end, pt)) {
+                points->push_back(pt);
+            }
+            line = p + LowestBit(mask) + 1;
+        }
+    }
+    p = line;
+#endif
+    while (p < terminated) {
+        if (cancel && ++lines == CANCEL_LINES) {
+            if (cancel->load(std::memory_order_relaxed)) return;
+            lines = 0;
+        }
+        if (ScanPoint<false>(p, end, pt)) points->push_back(pt);
+        p = SkipLine(p, terminated);
+    }
+    if (p < end && ScanPoint<true>(p, end, pt)) points->push_back(pt);
+}
+
+bool TrailReader::ReadPoints(std::vector<TrailPoint>& points, int threads, unsigned long long minBytes,
+                             const std::atomic<bool>* cancel) {
+    if (!m_file || m_binary || !m_map.IsOpen() || m_filtered || m_map.Size() - m_mapPos < minBytes) return false;
+
+    // SeekToTime lands up to IndexEvery records early; Next() skips those
+    TrailSample s;
+    long long count;
+    if (m_seekT != 0) {
+        if (!Next(s, count)) return true;
+        TrailPoint pt = { s.x, s.y };
+        points.push_back(pt);
+        if (m_mapPos >= m_map.Size()) return true; // That was the last line
+    }
+
+    const char* base = (const char*)m_map.Data();
+    const char* begin = base + m_mapPos;
+    const char* end = base + m_map.Size();
+    const char* terminated = base + m_textTerminated;
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    size_t maxParts = (size_t)(end - begin) / MIN_PART_BYTES;
+    size_t parts = threads > 1 ? (size_t)threads : 1;
+    if (parts > maxParts) parts = maxParts > 0 ? maxParts : 1;
+
+    // Each cut moves forward to just after a newline, so no line is split
+    std::vector<const char*> cuts(parts + 1, end);
+    cuts[0] = begin;
+    for (size_t i = 1; i < parts; ++i) {
+        const char* c = begin + (size_t)(end - begin) / parts * i;
+        if (c < cuts[i - 1]) c = cuts[i - 1];
+        const char* nl = c < terminated ? (const char*)memchr(c, '\n', terminated - c) : NULL;
+        cuts[i] = nl ? nl + 1 : end;
+    }
+
+    std::vector<std::vector<TrailPoint> > found(parts);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < parts; ++i) {
+        const char* partEnd = cuts[i + 1];
+        workers.push_back(std::thread(ScanPoints, cuts[i], partEnd, partEnd < terminated ? partEnd : terminated,
+                                      &found[i], cancel));
+    }
+    ScanPoints(cuts[0], cuts[1], cuts[1] < terminated ? cuts[1] : terminated, &found[0], cancel);
+    for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+
+    // The first part is taken over rather than copied (all of it on one thread)
+    size_t first = 0;
+    if (points.empty()) {
+        points.swap(found[0]);
+        first = 1;
+    }
+    size_t total = points.size();
+    for (size_t i = first; i < parts; ++i) total += found[i].size();
+    points.reserve(total);
+    for (size_t i = first; i < parts; ++i) points.insert(points.end(), found[i].begin(), found[i].end());
+    m_mapPos = m_map.Size();
+    return true;
+}
+
+void TrailReader::ReadSessionLine(const char* line) {
+    if (strncmp(line, "# session ", 10) != 0) return;
+    m_screenW = m_screenH = 0;
+    sscanf(line, "# session wall_ns=%lld mono_ns=%lld interval_ms=%d screen=%dx%d",
+           &m_wallNs, &m_monoNs, &m_intervalMs, &m_screenW, &m_screenH);
+}
+
+bool TrailReader::ReadHeader() {
+    unsigned char h[HEADER_SIZE];
+    if (!ReadBytes(h, 8) || memcmp(h, BINARY_MAGIC, 4) != 0) return false;
+
+    unsigned int size = GetU16(h + 6);
+    if (size < HEADER_SIZE || !ReadBytes(h + 8, HEADER_SIZE - 8)) return false;
+    // Newer versions may append fields, skip what we don't know
+    if (size > HEADER_SIZE) SkipBytes(size - HEADER_SIZE);
+
+    m_screenW = (int)GetU32(h + 8);
+    m_screenH = (int)GetU32(h + 12);
+    m_intervalMs = (int)GetU32(h + 16);
+    m_wallNs = (long long)GetU64(h + 24);
+    m_monoNs = (long long)GetU64(h + 32);
+    return true;
+}
+
+// Binary input comes from the mapping (at m_mapPos) when there is one, else the FILE
+
+int TrailReader::PeekByte() {
+    if (m_map.IsOpen()) return m_mapPos < m_map.Size() ? m_map.Data()[m_mapPos] : -1;
+    int c = fgetc(m_file);
+    if (c == EOF) return -1;
+    ungetc(c, m_file);
+    return c;
+}
+
+bool TrailReader::ReadBytes(unsigned char* p, size_t n) {
+    if (!m_map.IsOpen()) return fread(p, 1, n, m_file) == n;
+    if (m_mapPos > m_map.Size() || m_map.Size() - m_mapPos < n) return false;
+    memcpy(p, m_map.Data() + m_mapPos, n);
+    m_mapPos += n;
+    return true;
+}
+
+bool TrailReader::SkipBytes(long long n) {
+    if (!m_map.IsOpen()) return SeekFile64(m_file, n, SEEK_CUR) == 0;
+    m_mapPos = (size_t)((long long)m_mapPos + n);
+    return true;
+}
+
+// Points m_payload at the next size bytes: in place when mapped, else read into m_block
+bool TrailReader::ReadPayload(size_t size) {
+    if (m_map.IsOpen()) {
+        if (m_mapPos > m_map.Size() || m_map.Size() - m_mapPos < size) return false;
+        m_payload = m_map.Data() + m_mapPos;
+        m_mapPos += size;
+    } else {
+        m_block.resize(size);
+        if (size > 0 && fread(&m_block[0], 1, size, m_file) != size) return false;
+        m_payload = size ? &m_block[0] : NULL;
+    }
+    m_payloadSize = size;
+    return true;
+}
+
+// Loads the next sample block, handling headers and window blocks on the way
+bool TrailReader::ReadBlock() {
+    for (;;) {
+        int c = PeekByte();
+        if (c < 0) return false;
+
+        if (c == BINARY_MAGIC[0]) {
+            if (!ReadHeader()) return false;
+            continue;
+        }
+
+        unsigned char h[BLOCK_HEADER_SIZE];
+        if (!ReadBytes(h, sizeof(h))) return false;
+
+        unsigned int count = GetU32(h + 4);
+        unsigned int size = GetU32(h + 8);
+        if (size > MAX_BLOCK_PAYLOAD) {
+            m_badBlocks++;
+            return false; // Can't find the next block boundary
+        }
+
+        // A columnar chunk is judged on its stats before the rest is read
+        if (h[0] == 'C' && size >= TRAIL_CHUNK_STATS_SIZE && (m_filtered || m_seekT != 0)) {
+            unsigned char head[TRAIL_CHUNK_STATS_SIZE];
+            TrailChunkStats stats;
+            if (!ReadBytes(head, sizeof(head))) {
+                m_badBlocks++;
+                return false;
+            }
+            DecodeTrailChunkStats(head, sizeof(head), stats);
+            if ((m_filtered && !m_filter.Overlaps(stats)) || (m_seekT != 0 && stats.t1 < m_seekT)) {
+                m_skippedChunks++;
+                if (!SkipBytes(size - sizeof(head))) return false;
+                continue;
+            }
+            SkipBytes(-(long long)sizeof(head));
+        }
+
+        if (!ReadPayload(size)) {
+            m_badBlocks++; // Truncated tail, e.g. after a crash
+            return false;
+        }
+        if (Crc32(m_payload, size) != GetU32(h + 12)) {
+            m_badBlocks++;
+            continue;
+        }
+
+        m_pos = 0;
+        if (h[0] == 'C') {
+            if (!DecodeTrailChunk(m_payload, size, m_columns)) {
+                m_badBlocks++;
+                continue;
+            }
+            m_chunk = true;
+            m_left = (unsigned int)m_columns.Size();
+            return true;
+        }
+        if (h[0] == 'S') {
+            m_chunk = false;
+            m_left = count;
+            m_decoded = 0;
+            m_prev.x = m_prev.y = 0;
+            m_prev.t = 0;
+            m_prevDt = 0;
+            return true;
+        }
+        if (h[0] == 'W') {
+            unsigned long long id, handle, len;
+            if (GetVarint(m_payload, size, m_pos, id) && GetVarint(m_payload, size, m_pos, handle) &&
+                GetVarint(m_payload, size, m_pos, len) && m_pos + len <= size) {
+                SetWindow((int)id, std::string((const char*)m_payload + m_pos, (size_t)len).c_str());
+            }
+        }
+        // Unknown block types are skipped
+    }
+}
+
+bool TrailReader::NextBinary(TrailSample& s, long long& count) {
+    while (m_left == 0) {
+        if (!ReadBlock()) return false;
+    }
+
+    if (m_chunk) {
+        size_t i = m_columns.Size() - m_left--;
+        s.t = m_columns.t[i];
+        s.x = m_columns.x[i];
+        s.y = m_columns.y[i];
+        s.buttons = m_columns.buttons[i];
+        s.window = m_columns.window[i];
+        count = m_columns.count[i] > 0 ? m_columns.count[i] : 1;
+        m_runEnd = m_columns.last[i];
+        return true;
+    }
+
+    unsigned long long dx, dy, ddt, tag, buttons = 0, window = 0, span = 0;
+    const unsigned char* p = m_payload;
+    size_t n = m_payloadSize;
+    if (!GetVarint(p, n, m_pos, dx) || !GetVarint(p, n, m_pos, dy) ||
+        !GetVarint(p, n, m_pos, ddt) || !GetVarint(p, n, m_pos, tag) ||
+        ((tag & 1) && (!GetVarint(p, n, m_pos, buttons) || !GetVarint(p, n, m_pos, window))) ||
+        ((tag >> 1) > 1 && !GetVarint(p, n, m_pos, span))) {
+        // CRC matched but the payload doesn't decode: writer bug, drop the rest of the block
+        m_badBlocks++;
+        m_left = 0;
+        return NextBinary(s, count);
+    }
+
+    long long dt = m_prevDt + UnZigZag(ddt);
+    s.x = (int)(m_prev.x + UnZigZag(dx));
+    s.y = (int)(m_prev.y + UnZigZag(dy));
+    s.t = m_prev.t + dt;
+    s.buttons = (unsigned int)buttons;
+    s.window = (int)window;
+    count = (long long)(tag >> 1);
+    if (count < 1) count = 1;
+    m_runEnd = s.t + (long long)span;
+
+    m_prevDt = m_decoded == 0 ? 0 : dt;
+    m_prev = s;
+    m_decoded++;
+    m_left--;
+    return true;
+}
+
+bool ParseTrailLine(const char* line, TrailSample& s, long long& count, long long* last) {
+    const char* p = line;
+    long long end;
+    if (!ScanTrailLine<true>(p, line + strlen(line), s, count, end)) return false;
+    if (last) *last = end;
+    return true;
+}
+
+bool ParseWindowLine(const char* line, int& id, unsigned long long& handle, char* name, size_t nameSize) {
+    int offset = 0;
+    if (sscanf(line, "# window %d %llx %n", &id, &handle, &offset) < 2 || offset == 0) return false;
+
+    snprintf(name, nameSize, "%s", line + offset);
+    name[strcspn(name, "\r\n")] = 0;
+    return true;
+}
@@ -0,0 +1,344 @@
+/*
+    Trail Log
+    Text log format shared by the trackers:
+
+        # session wall_ns=<unix ns> mono_ns=<monotonic ns> interval_ms=<n> [screen=<w>x<h>]
+        # window <id> 0x<handle> <title>
+        x,y,t
+        x,y,t,n
+        x,y,t,n,buttons,window
+        x,y,t,n,buttons,window,last
+        ...
+        # end start=<offset> samples=<n> records=<n>
+
+    t is the CLOCK_MONOTONIC capture time in ns. Subtract mono_ns and add
+    wall_ns to get real time. A fourth column n means the cursor sat at x,y
+    for n consecutive samples, starting at t; last is the time of the run's
+    last sample (IdleInterval spaces a parked cursor's samples further
+    apart, so it can't be worked out from n). Runs are written with all
+    seven columns. buttons (TRAIL_BUTTON_* mask) and window (an ID from a
+    "# window" line earlier in the file) are otherwise only written when
+    either is non-zero. Lines starting with '#' are metadata,
+    so older "%d,%d" loaders skip them and read the first two columns of
+    samples.
+
+    Binary format (LogFormat=binary), all integers little-endian:
+
+        header  "MTRB" u16 version, u16 header size, i32 screen w, i32 screen h,
+                i32 interval_ms, u32 reserved, i64 wall_ns, i64 mono_ns
+        block   u8 type ('S' samples, 'W' window), 3 pad bytes,
+                u32 record count, u32 payload size, u32 CRC-32 of payload
+                payload...
+
+    'S' records: zigzag varints dx, dy (from the previous record), then the
+    time as delta-of-delta (the first record of a block holds t itself),
+    then varint (n << 1 | extra); extra means varints buttons and window
+    follow. A run (n > 1) ends with varint last - t. Every block starts
+    from x = y = t = 0, so blocks decode on their own and a corrupt block
+    is skipped without losing the rest.
+    'W' records: varint id, varint handle, varint length, title bytes.
+    'C' block (LogFormat=columnar, instead of 'S'): up to CHUNK_RECORDS
+    records as columns with per-chunk stats, see trail_columns.h. A reader
+    with SetFilter() or SeekToTime() skips chunks whose stats don't match
+    without decoding (or checksumming) them.
+    'E' block (the footer, no records): u64 start, u64 samples, u64 records.
+    Appending a session (AutoClear=0) writes a new header mid-file.
+
+    Close() ends the session with a footer giving the byte offset of its
+    header, so the latest session of an appended log is found from the last
+    bytes of the file instead of by reading all the ones before it. A
+    session cut short by a crash has no footer.
+
+    Index sidecar (<log>.idx, IndexEvery=K), so a reader can jump to a
+    time without parsing from the start:
+
+        header  "MTRI" u16 version, u16 entry size, u32 K, u32 reserved
+        entry   i64 t, u64 byte offset in the log
+
+    An entry is written at most every K samples, at a record (text) or at
+    the start of a sample block (binary), so decoding can begin right at
+    the offset. Entries are appended like the log, so AutoClear=0 keeps
+    one index for all sessions.
+
+    Writes are group-committed: Flush() only reaches the OS once
+    CommitSamples samples or CommitMs ms have piled up since the last
+    commit, so a crash loses at most that much. A run still going (a parked
+    cursor) is written up to its latest sample at each commit and continues
+    as a new record. Binary sample blocks are cut at each commit (or every
+    BLOCK_RECORDS records). Durability adds
+    fdatasync (_commit on Windows): none = never, batch = at each group
+    commit, every = commit and sync on every Flush() call.
+*/
+
+#ifndef TRAIL_LOG_H
+#define TRAIL_LOG_H
+
+#include <stdio.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include "trail_sample.h"
+#include "trail_columns.h"
+#include "mapped_file.h"
+
+enum TrailFormat {
+    TRAIL_FORMAT_TEXT,
+    TRAIL_FORMAT_BINARY,
+    TRAIL_FORMAT_COLUMNAR  // Binary file with 'C' chunks
+};
+
+// "binary" / "columnar", anything else is text
+TrailFormat ParseTrailFormat(const char* name);
+
+enum TrailDurability {
+    TRAIL_SYNC_NONE,
+    TRAIL_SYNC_BATCH,
+    TRAIL_SYNC_EVERY
+};
+
+// "batch" / "every", anything else is none
+TrailDurability ParseTrailDurability(const char* name);
+
+class TrailWriter {
+public:
+    TrailWriter();
+    ~TrailWriter();
+
+    // Takes ownership of an already opened file and writes the session header.
+    // Open it in binary mode ("wb"/"ab") for every format: Windows text
+    // mode writes "\r\n", and the index and footer offsets come from ftell.
+    void Open(FILE* f, int intervalMs, TrailFormat format = TRAIL_FORMAT_TEXT,
+              int screenW = 0, int screenH = 0);
+    bool IsOpen() const { return m_file != NULL; }
+    // Takes ownership of the index sidecar (opened "wb"/"ab" like the log);
+    // call right after Open. everySamples <= 0 writes no entries.
+    void OpenIndex(FILE* idx, int everySamples);
+
+    // Group commit thresholds (whichever comes first) and sync policy.
+    // Defaults: 1000 samples / 1000 ms, no sync.
+    void SetCommitPolicy(int maxSamples, int maxMs, TrailDurability durability);
+
+    // Repeats of the previous position are held back and written as one
+    // run record once the cursor moves (or at the next commit or Close)
+    void Append(const TrailSample& s);
+    // Defines a window ID; must come before the first sample that uses it
+    void WriteWindow(int id, unsigned long long handle, const char* name);
+    // Call after each batch of Appends; commits when a threshold is reached
+    void Flush();
+    // Commits now, regardless of the thresholds
+    void Commit();
+    void Close();
+
+    // Stats
+    unsigned long long GetSampleCount() const { return m_samples; }
+    unsigned long long GetRecordCount() const { return m_records; }
+    unsigned long long GetCommitCount() const { return m_commits; }
+    unsigned long long GetSyncCount() const { return m_syncs; }
+
+private:
+    static const int BLOCK_RECORDS = 1024;
+    static const int CHUNK_RECORDS = 4096;
+    static const int STDIO_BUFFER = 64 * 1024;
+
+    void WriteRun();
+    void EncodeRun();
+    void WriteBlock(char type, unsigned int count, const std::vector<unsigned char>& payload);
+    void FlushBlock();
+    void Sync();
+    void WriteIndexEntry(long long t);
+    void WriteFooter();
+
+    FILE* m_file;
+    std::vector<char> m_stdioBuffer; // m_file's, until it is closed
+    long long m_sessionStart; // Offset of this session's header
+    TrailFormat m_format;
+    TrailSample m_run;
+    long long m_runCount;
+    long long m_runEnd;       // Time of the run's last sample
+    unsigned long long m_samples;
+    unsigned long long m_records;
+
+    // Group commit
+    int m_commitSamples;
+    long long m_commitNs;
+    TrailDurability m_durability;
+    int m_uncommitted;
+    long long m_lastCommit;
+    unsigned long long m_commits;
+    unsigned long long m_syncs;
+
+    // Binary: open sample block and its delta state
+    std::vector<unsigned char> m_block;
+    unsigned int m_blockRecords;
+    TrailSample m_prev;
+    long long m_prevDt;
+    TrailColumns m_columns; // Columnar: records of the open chunk
+
+    // Index sidecar
+    FILE* m_index;
+    long long m_indexEvery;
+    long long m_sinceIndex;  // Samples since the last entry
+    bool m_blockIndexed;     // Open block gets an entry when written
+    long long m_blockT;
+};
+
+struct TrailRingRecord;
+
+// Reads any log (text, binary or a trail_ring.h ring, detected from the
+// first bytes) one record at a time, oldest first. Text and binary logs in
+// a regular file are memory-mapped: text is scanned in place rather than
+// read by line, binary blocks are checked and decoded in place.
+class TrailReader {
+public:
+    TrailReader();
+    ~TrailReader();
+
+    // Takes ownership of a file opened in binary mode ("rb")
+    bool Open(FILE* f);
+    void Close();
+    // Takes ownership of the log's .idx sidecar. False if it isn't one.
+    bool OpenIndex(FILE* idx);
+
+    // Call right after Open: Next() then starts at the first record at or
+    // after t (sample time). Uses the index, or a binary search for rings;
+    // without either it still skips earlier records, just by reading them.
+    // Window titles defined before the jump are not known. Returns whether
+    // it could jump.
+    bool SeekToTime(long long t);
+
+    // Call after Open: Next() then only returns records inside the
+    // filter's time range and region. Columnar chunks outside it are skipped unread; other formats
+    // still read every record.
+    void SetFilter(const TrailChunkFilter& filter);
+
+    // Next sample record; count is its run length. False at end of file.
+    bool Next(TrailSample& s, long long& count);
+    // Time of the last sample of the record Next() returned (its t for a
+    // single sample; for a text line without the last column, estimated
+    // from the interval)
+    long long GetRunEnd() const { return m_runEnd; }
+
+    // Appends the position of every record left, for a mapped text log with
+    // at least minBytes to go: the rest of the file is cut at newlines into
+    // one part per thread (threads <= 0: one per core), parsed in parallel
+    // and joined in order. Window and session lines aren't read. False,
+    // having read nothing, for anything else (smaller, binary, ring, a
+    // filter); use Next() then. Setting cancel (from another thread) stops
+    // every part within a few thousand lines, leaving points incomplete.
+    bool ReadPoints(std::vector<TrailPoint>& points, int threads, unsigned long long minBytes,
+                    const std::atomic<bool>* cancel = NULL);
+
+    bool IsBinary() const { return m_binary; }
+    bool IsRing() const { return m_ring; }
+    // From the most recent session header read (the first one right after Open; 0 if unknown)
+    int GetIntervalMs() const { return m_intervalMs; }
+    int GetScreenWidth() const { return m_screenW; }
+    int GetScreenHeight() const { return m_screenH; }
+    long long GetWallNs() const { return m_wallNs; }
+    long long GetMonoNs() const { return m_monoNs; }
+
+    // Call right after Open: Next() then reads only the last session, found
+    // through its footer (without one, after a crash, the last header is
+    // searched for; rings start at the time their header was last opened).
+    // False if it can't be found; the reader stays at the start.
+    bool SeekToLastSession();
+
+    // Remembers the current position (right after Open or a seek, not
+    // inside a binary block) so ReturnToMark() can read the same records
+    // again without reopening; SeekToTime's pending skip is kept too
+    bool SetMark();
+    bool ReturnToMark();
+
+    // The log is read from a memory mapping (a regular file, not a ring)
+    bool IsMapped() const { return m_map.IsOpen(); }
+
+    // Records left from the current position, roughly (from the file size
+    // for logs, exact for rings), for reserving before a load
+    unsigned long long EstimateRecords();
+
+    // Title of a window ID seen so far ("" if unknown)
+    const char* GetWindowName(int id) const;
+    // Binary blocks dropped for a bad checksum or truncation
+    unsigned long long GetBadBlocks() const { return m_badBlocks; }
+    // Columnar chunks skipped on their stats alone
+    unsigned long long GetSkippedChunks() const { return m_skippedChunks; }
+
+private:
+    bool NextText(TrailSample& s, long long& count);
+    bool NextMapped(TrailSample& s, long long& count);
+    bool SeekFile(long long offset);
+    bool NextBinary(TrailSample& s, long long& count);
+    int PeekByte();
+    bool ReadBytes(unsigned char* p, size_t n);
+    bool SkipBytes(long long n);
+    bool ReadPayload(size_t size);
+    bool NextRing(TrailSample& s, long long& count);
+    bool OpenRing();
+    bool ReadHeader();
+    bool ReadBlock();
+    void SetWindow(int id, const char* name);
+    void ReadSessionLine(const char* line);
+    bool SeekRing(long long t);
+    bool FindLastSessionText(long long& start);
+    bool FindLastSessionBinary(long long& start);
+
+    struct IndexEntry {
+        long long t;
+        unsigned long long offset;
+    };
+
+    FILE* m_file;
+    bool m_binary;
+    bool m_ring;
+    int m_intervalMs, m_screenW, m_screenH;
+    long long m_wallNs, m_monoNs;
+    std::vector<std::string> m_windows;
+    unsigned long long m_badBlocks;
+
+    // Binary: current sample block (in the mapping, or read into m_block) and its delta state
+    std::vector<unsigned char> m_block;
+    const unsigned char* m_payload;
+    size_t m_payloadSize;
+    size_t m_pos;
+    unsigned int m_left, m_decoded;
+    TrailSample m_prev;
+    long long m_prevDt;
+    bool m_chunk;            // Current block is columnar, read from m_columns
+    TrailColumns m_columns;
+    long long m_runEnd;
+
+    // Ring: next and end record index, slots read in chunks; time seeks
+    // start at m_ringEpoch (the current boot)
+    unsigned long long m_ringCapacity, m_ringEpoch, m_ringNext, m_ringEnd;
+    std::vector<TrailRingRecord> m_ringChunk;
+    size_t m_ringPos;
+
+    // Text and binary: the mapped file and the next line's / block's offset
+    // (unmapped: fgets / fread)
+    MappedFile m_map;
+    size_t m_mapPos;
+    size_t m_textTerminated;  // Text: up to (after) the last newline
+
+    std::vector<IndexEntry> m_index;
+    bool m_indexSorted;
+    long long m_seekT;       // Records before this are skipped (0 = none)
+    TrailChunkFilter m_filter;
+    bool m_filtered;
+    unsigned long long m_skippedChunks;
+
+    // SetMark(): file offset (ring: record index), pending skip, interval
+    bool m_marked;
+    long long m_markOffset;
+    long long m_markSeekT;
+    int m_markIntervalMs;
+};
+
+// Parses one sample line. count is the run length (1 for plain samples),
+// last gets the run's last sample time (0 if the line has none).
+// Returns false for metadata and malformed lines.
+bool ParseTrailLine(const char* line, TrailSample& s, long long& count, long long* last = NULL);
+
+// Parses a "# window" line. name gets the title (may be empty).
+bool ParseWindowLine(const char* line, int& id, unsigned long long& handle, char* name, size_t nameSize);
+
+#endif
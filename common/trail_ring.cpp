@@ -0,0 +1,112 @@
+#include "trail_ring.h"
+#include "trail_clock.h"
+
+#include <string.h>
+
+TrailRing::TrailRing()
+    : m_header(NULL), m_slots(NULL), m_hasLast(false),
+      m_syncNs(1000000000LL), m_durability(TRAIL_SYNC_NONE), m_lastSync(0),
+      m_samples(0), m_records(0), m_syncs(0) {}
+
+TrailRing::~TrailRing() {
+    Close();
+}
+
+void TrailRing::SetCommitPolicy(int maxMs, TrailDurability durability) {
+    m_syncNs = (long long)(maxMs > 0 ? maxMs : 0) * 1000000LL;
+    m_durability = durability;
+}
+
+bool TrailRing::Open(const char* path, size_t bytes, int intervalMs, int screenW, int screenH) {
+    Close();
+
+    size_t capacity = bytes > RING_HEADER_SIZE ? (bytes - RING_HEADER_SIZE) / sizeof(TrailRingRecord) : 0;
+    if (capacity < 1) return false;
+    if (!m_map.Open(path, RING_HEADER_SIZE + capacity * sizeof(TrailRingRecord))) return false;
+
+    m_header = (TrailRingHeader*)m_map.Data();
+    m_slots = (TrailRingRecord*)(m_map.Data() + RING_HEADER_SIZE);
+
+    bool valid = m_map.Existed() && memcmp(m_header->magic, RING_MAGIC, 4) == 0 &&
+                 m_header->version == RING_VERSION &&
+                 m_header->recordSize == sizeof(TrailRingRecord) &&
+                 m_header->capacity == capacity && m_header->head >= m_header->tail;
+    if (!valid) {
+        // New file, other size or version, or not a ring: start empty
+        memset(m_header, 0, RING_HEADER_SIZE);
+        memcpy(m_header->magic, RING_MAGIC, 4);
+        m_header->version = RING_VERSION;
+        m_header->recordSize = sizeof(TrailRingRecord);
+        m_header->capacity = capacity;
+    }
+
+    long long mono = GetMonotonicNs();
+    long long wall = GetWallClockNs();
+    if (m_header->head > m_header->tail && m_slots[(m_header->head - 1) % capacity].last > mono) {
+        m_header->epoch = m_header->head; // Rebooted since: earlier times aren't comparable
+    }
+    m_header->sessions++;
+    m_header->intervalMs = intervalMs;
+    m_header->screenW = screenW;
+    m_header->screenH = screenH;
+    m_header->wallNs = wall;
+    m_header->monoNs = mono;
+
+    m_hasLast = false; // Runs don't continue across sessions
+    m_lastSync = mono;
+    m_samples = 0;
+    m_records = 0;
+    m_syncs = 0;
+    return true;
+}
+
+void TrailRing::Append(const TrailSample& s) {
+    if (!m_header) return;
+    m_samples++;
+
+    unsigned long long head = m_header->head;
+    if (m_hasLast) {
+        TrailRingRecord& last = m_slots[(head - 1) % m_header->capacity];
+        if (last.x == s.x && last.y == s.y && last.buttons == s.buttons && last.count < 0xFFFFFFFFu) {
+            last.count++;
+            last.last = s.t;
+            return;
+        }
+    }
+
+    TrailRingRecord& r = m_slots[head % m_header->capacity];
+    r.t = s.t;
+    r.x = s.x;
+    r.y = s.y;
+    r.count = 1;
+    r.buttons = s.buttons;
+    r.last = s.t;
+
+    // Publish after the record is complete
+    m_header->head = head + 1;
+    if (head + 1 > m_header->capacity) m_header->tail = head + 1 - m_header->capacity;
+    m_hasLast = true;
+    m_records++;
+}
+
+void TrailRing::Flush() {
+    if (!m_header || m_durability == TRAIL_SYNC_NONE) return;
+
+    long long now = GetMonotonicNs();
+    if (m_durability == TRAIL_SYNC_EVERY || now - m_lastSync >= m_syncNs) {
+        m_map.Sync(true);
+        m_lastSync = now;
+        m_syncs++;
+    }
+}
+
+void TrailRing::Close() {
+    if (!m_header) return;
+    if (m_durability != TRAIL_SYNC_NONE) {
+        m_map.Sync(true);
+        m_syncs++;
+    }
+    m_map.Close();
+    m_header = NULL;
+    m_slots = NULL;
+}
@@ -0,0 +1,100 @@
+/*
+    Trail Ring
+    Always-on log (AutoClear=2): a preallocated, memory-mapped file of
+    fixed size that keeps the most recent samples and overwrites the
+    oldest. Disk usage never changes and logging a sample is a couple of
+    memory stores; the kernel writes the pages back on its own, so even a
+    crash of the tracker loses nothing (Durability only matters for a
+    crash of the whole machine).
+
+        header  TrailRingHeader, padded to RING_HEADER_SIZE
+        records TrailRingRecord[capacity], slot = index % capacity
+
+    head counts every record ever written, the oldest one still present is
+    tail = max(0, head - capacity), so records tail..head-1 are the ring in
+    chronological order. A sample at the same position as the newest record
+    bumps its count and last time in place (same runs as the text log). A
+    ring from an older version is started over.
+
+    Records use host byte order (little-endian on every supported target).
+    t is CLOCK_MONOTONIC, which restarts at boot; the header anchors only
+    the latest session. Open() notices the clock went back past the newest
+    record (a reboot) and starts a new epoch at head, so records from epoch
+    on are in time order and time seeks only search those. Window IDs are not kept (they are per session).
+    TrailReader reads rings like any other log.
+*/
+
+#ifndef TRAIL_RING_H
+#define TRAIL_RING_H
+
+#include "mapped_file.h"
+#include "trail_log.h"
+#include "trail_sample.h"
+
+static const char RING_MAGIC[4] = { 'M', 'T', 'R', 'R' };
+static const unsigned int RING_VERSION = 1;
+static const unsigned int RING_HEADER_SIZE = 4096;
+
+struct TrailRingHeader {
+    char magic[4];                  // "MTRR"
+    unsigned short version;
+    unsigned short recordSize;
+    unsigned int sessions;          // Opens since the ring was created
+    int intervalMs, screenW, screenH;
+    unsigned long long capacity;    // Records
+    unsigned long long head;        // Records ever written
+    unsigned long long tail;        // Oldest record still in the ring
+    long long wallNs, monoNs;       // Anchor of the latest session
+    unsigned long long epoch;       // First record since the clock last restarted
+};
+
+struct TrailRingRecord {
+    long long t;
+    int x, y;
+    unsigned int count;
+    unsigned int buttons;
+    long long last;                 // Time of the run's last sample
+};
+
+static_assert(sizeof(TrailRingHeader) == 72, "ring header layout");
+static_assert(sizeof(TrailRingRecord) == 32, "ring record layout");
+
+class TrailRing {
+public:
+    TrailRing();
+    ~TrailRing();
+
+    // Opens path, or creates it at bytes (rounded down to whole records).
+    // An existing ring of the same size keeps its history.
+    bool Open(const char* path, size_t bytes, int intervalMs, int screenW, int screenH);
+    bool IsOpen() const { return m_header != NULL; }
+
+    // Sync cadence for Flush(), as on TrailWriter (samples don't apply)
+    void SetCommitPolicy(int maxMs, TrailDurability durability);
+
+    void Append(const TrailSample& s);
+    void Flush();
+    void Close();
+
+    // Stats
+    unsigned long long GetSampleCount() const { return m_samples; }
+    unsigned long long GetRecordCount() const { return m_records; }
+    unsigned long long GetSyncCount() const { return m_syncs; }
+    unsigned long long GetCapacity() const { return m_header ? m_header->capacity : 0; }
+
+private:
+    MappedFile m_map;
+    TrailRingHeader* m_header;
+    TrailRingRecord* m_slots;
+    bool m_hasLast;
+
+    long long m_syncNs;
+    TrailDurability m_durability;
+    long long m_lastSync;
+
+    unsigned long long m_samples;
+    unsigned long long m_records;
+    unsigned long long m_syncs;
+};
+
+#endif
@@ -0,0 +1,29 @@
+/*
+    Trail Sample
+    One captured cursor position, shared by the capture, logging and
+    review code of every frontend.
+*/
+
+#ifndef TRAIL_SAMPLE_H
+#define TRAIL_SAMPLE_H
+
+// Mouse buttons held, bit 0 = left, 1 = middle, 2 = right, 3/4 = wheel
+enum {
+    TRAIL_BUTTON_LEFT = 1,
+    TRAIL_BUTTON_MIDDLE = 2,
+    TRAIL_BUTTON_RIGHT = 4
+};
+
+struct TrailSample {
+    long long t;    // CLOCK_MONOTONIC capture time in ns (see trail_clock.h)
+    int x, y;
+    unsigned int buttons = 0; // TRAIL_BUTTON_* mask, 0 if the source has none
+    int window = 0;           // ID in the session's WindowTable, 0 = none/unknown
+};
+
+// Just the position, what a review trail draws
+struct TrailPoint {
+    int x, y;
+};
+
+#endif
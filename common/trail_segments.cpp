@@ -0,0 +1,328 @@
+#include "trail_segments.h"
+#include "trail_clock.h"
+#include "file_offset.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+std::string TrailManifestPath(const char* base) {
+    return std::string(base) + ".manifest";
+}
+
+// Directory part of path, with its separator ("" for a bare name)
+static std::string DirOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+static std::string BaseNameOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// --- TrailManifest ---
+
+bool TrailManifest::Load(const char* path) {
+    m_segments.clear();
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') continue;
+
+        char name[512];
+        TrailSegmentInfo seg;
+        if (sscanf(line, "%511s %lld %lld %llu %d %d %d %d", name, &seg.t0, &seg.t1, &seg.points,
+                   &seg.minX, &seg.minY, &seg.maxX, &seg.maxY) != 8) continue;
+        seg.file = name;
+        m_segments.push_back(seg);
+    }
+    fclose(f);
+    return true;
+}
+
+bool TrailManifest::Save(const char* path) const {
+    std::string tmp = std::string(path) + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f) return false;
+
+    fprintf(f, "# manifest v1\n");
+    for (size_t i = 0; i < m_segments.size(); ++i) {
+        const TrailSegmentInfo& seg = m_segments[i];
+        fprintf(f, "%s %lld %lld %llu %d %d %d %d\n", seg.file.c_str(), seg.t0, seg.t1, seg.points,
+                seg.minX, seg.minY, seg.maxX, seg.maxY);
+    }
+    bool ok = fclose(f) == 0;
+
+#ifdef _WIN32
+    remove(path); // rename() won't replace an existing file here
+#endif
+    return ok && rename(tmp.c_str(), path) == 0;
+}
+
+std::vector<size_t> TrailManifest::Select(long long fromNs, long long toNs) const {
+    std::vector<size_t> out;
+    for (size_t i = 0; i < m_segments.size(); ++i) {
+        if (m_segments[i].t1 >= fromNs && m_segments[i].t0 <= toNs) out.push_back(i);
+    }
+    return out;
+}
+
+// --- TrailSegmentWriter ---
+
+TrailSegmentWriter::TrailSegmentWriter()
+    : m_file(NULL), m_nextIndex(1), m_intervalMs(0), m_screenW(0), m_screenH(0),
+      m_format(TRAIL_FORMAT_TEXT), m_commitSamples(1000), m_commitMs(1000), m_durability(TRAIL_SYNC_NONE),
+      m_indexEvery(0), m_opener(fopen), m_maxBytes(0), m_maxNs(0), m_keep(0), m_wallOffset(0),
+      m_samples(0), m_records(0), m_commits(0), m_syncs(0), m_segmentsOpened(0) {}
+
+TrailSegmentWriter::~TrailSegmentWriter() {
+    Close();
+}
+
+void TrailSegmentWriter::SetSegmentLimits(int maxMB, int maxMinutes, int keep) {
+    m_maxBytes = (long long)(maxMB > 0 ? maxMB : 0) << 20;
+    m_maxNs = (long long)(maxMinutes > 0 ? maxMinutes : 0) * 60 * 1000000000LL;
+    m_keep = keep > 0 ? keep : 0;
+}
+
+void TrailSegmentWriter::SetCommitPolicy(int maxSamples, int maxMs, TrailDurability durability) {
+    m_commitSamples = maxSamples;
+    m_commitMs = maxMs;
+    m_durability = durability;
+}
+
+void TrailSegmentWriter::SetIndexEvery(int everySamples) {
+    m_indexEvery = everySamples > 0 ? everySamples : 0;
+}
+
+void TrailSegmentWriter::SetFileOpener(TrailFileOpener opener) {
+    m_opener = opener ? opener : fopen;
+}
+
+bool TrailSegmentWriter::Open(const char* base, bool append, int intervalMs, TrailFormat format,
+                              int screenW, int screenH) {
+    Close();
+    m_base = base;
+    m_manifestPath = TrailManifestPath(base);
+    m_intervalMs = intervalMs;
+    m_format = format;
+    m_screenW = screenW;
+    m_screenH = screenH;
+    m_windows.clear();
+    m_samples = m_records = m_commits = m_syncs = m_segmentsOpened = 0;
+
+    m_manifest.Load(m_manifestPath.c_str());
+    std::vector<TrailSegmentInfo>& segs = m_manifest.Segments();
+    if (!append) {
+        for (size_t i = 0; i < segs.size(); ++i) RemoveSegment(segs[i].file);
+        segs.clear();
+    }
+
+    // Continue after the highest index already listed
+    m_nextIndex = 1;
+    for (size_t i = 0; i < segs.size(); ++i) {
+        // "<base>.000001.txt"
+        size_t ext = segs[i].file.rfind('.');
+        size_t num = ext == std::string::npos || ext == 0 ? std::string::npos : segs[i].file.rfind('.', ext - 1);
+        if (num == std::string::npos) continue;
+        unsigned int index = (unsigned int)strtoul(segs[i].file.c_str() + num + 1, NULL, 10);
+        if (index >= m_nextIndex) m_nextIndex = index + 1;
+    }
+
+    long long mono = GetMonotonicNs();
+    m_wallOffset = GetWallClockNs() - mono;
+    return OpenSegment();
+}
+
+bool TrailSegmentWriter::OpenSegment() {
+    std::string path;
+    FILE* f = CreateSegmentFile(path);
+    if (!f) return false;
+    StartSegment(f, path);
+    return true;
+}
+
+// The index is only used up once the file exists, so a retry reuses it
+FILE* TrailSegmentWriter::CreateSegmentFile(std::string& path) {
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%06u.%s", m_nextIndex,
+             m_format != TRAIL_FORMAT_TEXT ? "bin" : "txt");
+    path = m_base + suffix;
+
+    FILE* f = m_opener(path.c_str(), "wb");
+    if (f) m_nextIndex++;
+    return f;
+}
+
+void TrailSegmentWriter::StartSegment(FILE* f, const std::string& path) {
+    m_writer.SetCommitPolicy(m_commitSamples, m_commitMs, m_durability);
+    m_writer.Open(f, m_intervalMs, m_format, m_screenW, m_screenH);
+    if (m_indexEvery > 0) m_writer.OpenIndex(fopen((path + ".idx").c_str(), "wb"), m_indexEvery);
+    m_file = f;
+    m_segmentsOpened++;
+
+    // Each segment reads on its own
+    for (size_t i = 0; i < m_windows.size(); ++i) {
+        m_writer.WriteWindow(m_windows[i].id, m_windows[i].handle, m_windows[i].name.c_str());
+    }
+
+    // Listed right away, open-ended, so a crash doesn't orphan it
+    TrailSegmentInfo seg;
+    seg.file = BaseNameOf(path);
+    seg.t0 = GetMonotonicNs() + m_wallOffset;
+    seg.t1 = TRAIL_SEGMENT_OPEN;
+    seg.points = 0;
+    seg.minX = seg.minY = seg.maxX = seg.maxY = 0;
+    m_manifest.Segments().push_back(seg);
+    Prune();
+    m_manifest.Save(m_manifestPath.c_str());
+}
+
+void TrailSegmentWriter::CloseSegment() {
+    if (!m_writer.IsOpen()) return;
+    m_writer.Close();
+    m_file = NULL;
+
+    m_samples += m_writer.GetSampleCount();
+    m_records += m_writer.GetRecordCount();
+    m_commits += m_writer.GetCommitCount();
+    m_syncs += m_writer.GetSyncCount();
+
+    // A segment that never got a sample isn't worth listing
+    std::vector<TrailSegmentInfo>& segs = m_manifest.Segments();
+    if (segs.back().points == 0) {
+        RemoveSegment(segs.back().file);
+        segs.pop_back();
+        m_segmentsOpened--;
+    }
+    m_manifest.Save(m_manifestPath.c_str());
+}
+
+// Drops the oldest closed segments beyond m_keep (the open one doesn't count)
+void TrailSegmentWriter::Prune() {
+    std::vector<TrailSegmentInfo>& segs = m_manifest.Segments();
+    if (m_keep == 0 || segs.size() <= (size_t)m_keep + 1) return;
+
+    size_t drop = segs.size() - (m_keep + 1);
+    for (size_t i = 0; i < drop; ++i) RemoveSegment(segs[i].file);
+    segs.erase(segs.begin(), segs.begin() + drop);
+}
+
+// The segment and its index, if any
+void TrailSegmentWriter::RemoveSegment(const std::string& file) {
+    std::string path = DirOf(m_manifestPath) + file;
+    remove(path.c_str());
+    remove((path + ".idx").c_str());
+}
+
+void TrailSegmentWriter::Append(const TrailSample& s) {
+    if (!m_writer.IsOpen()) return;
+    m_writer.Append(s);
+
+    TrailSegmentInfo& seg = m_manifest.Segments().back();
+    long long t = s.t + m_wallOffset;
+    if (seg.points == 0) {
+        seg.t0 = t;
+        seg.minX = seg.maxX = s.x;
+        seg.minY = seg.maxY = s.y;
+    } else {
+        if (s.x < seg.minX) seg.minX = s.x;
+        if (s.x > seg.maxX) seg.maxX = s.x;
+        if (s.y < seg.minY) seg.minY = s.y;
+        if (s.y > seg.maxY) seg.maxY = s.y;
+    }
+    seg.t1 = t;
+    seg.points++;
+}
+
+void TrailSegmentWriter::WriteWindow(int id, unsigned long long handle, const char* name) {
+    if (!m_writer.IsOpen()) return;
+    WindowDef w;
+    w.id = id;
+    w.handle = handle;
+    w.name = name ? name : "";
+    m_windows.push_back(w);
+    m_writer.WriteWindow(id, handle, name);
+}
+
+bool TrailSegmentWriter::Flush() {
+    if (!m_writer.IsOpen()) return true;
+    m_writer.Flush();
+
+    const TrailSegmentInfo& seg = m_manifest.Segments().back();
+    if (seg.points == 0) return true; // Never rotate into an empty segment
+
+    bool full = m_maxBytes > 0 && TellFile64(m_file) >= m_maxBytes;
+    bool old = m_maxNs > 0 && seg.t1 - seg.t0 >= m_maxNs;
+    if (!full && !old) return true;
+
+    // Next file first: if it can't be created (disk full, EMFILE) the
+    // logger keeps writing to this one instead of dropping everything
+    std::string path;
+    FILE* f = CreateSegmentFile(path);
+    if (!f) return false;
+    CloseSegment();
+    StartSegment(f, path);
+    return true;
+}
+
+void TrailSegmentWriter::Close() {
+    CloseSegment();
+}
+
+// --- TrailSegmentReader ---
+
+TrailSegmentReader::TrailSegmentReader()
+    : m_reading(false), m_next(0), m_from(0), m_to(TRAIL_SEGMENT_OPEN), m_badBlocks(0), m_estimate(0) {}
+
+bool TrailSegmentReader::Open(const char* manifestPath, long long fromNs, long long toNs) {
+    m_reader.Close();
+    m_reading = false;
+    m_files.clear();
+    m_next = 0;
+    m_from = fromNs;
+    m_to = toNs;
+    m_badBlocks = 0;
+    m_estimate = 0;
+
+    TrailManifest manifest;
+    if (!manifest.Load(manifestPath)) return false;
+
+    std::string dir = DirOf(manifestPath);
+    std::vector<size_t> picked = manifest.Select(fromNs, toNs);
+    for (size_t i = 0; i < picked.size(); ++i) {
+        m_files.push_back(dir + manifest.Segments()[picked[i]].file);
+        m_estimate += manifest.Segments()[picked[i]].points;
+    }
+    return true;
+}
+
+bool TrailSegmentReader::OpenNext() {
+    if (m_reading) m_badBlocks += m_reader.GetBadBlocks();
+    m_reader.Close();
+    m_reading = false;
+    while (m_next < m_files.size()) {
+        const std::string& path = m_files[m_next++];
+        if (!m_reader.Open(fopen(path.c_str(), "rb"))) continue;
+        m_reading = true;
+
+        // Jump to the start of the range instead of reading up to it
+        if (m_from > 0 && m_reader.GetWallNs() != 0 && m_reader.OpenIndex(fopen((path + ".idx").c_str(), "rb"))) {
+            m_reader.SeekToTime(m_from - m_reader.GetWallNs() + m_reader.GetMonoNs());
+        }
+        return true;
+    }
+    return false;
+}
+
+bool TrailSegmentReader::Next(TrailSample& s, long long& count) {
+    for (;;) {
+        while (m_reader.Next(s, count)) {
+            long long offset = m_reader.GetWallNs() - m_reader.GetMonoNs();
+            if (m_reader.GetRunEnd() + offset >= m_from && s.t + offset <= m_to) return true;
+        }
+        if (!OpenNext()) return false;
+    }
+}
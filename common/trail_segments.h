@@ -0,0 +1,163 @@
+/*
+    Trail Segments
+    Splits a long capture into segment files (SegmentMB / SegmentMinutes)
+    listed in a manifest, so review and export only open the segments
+    covering the time they want and retention (SegmentKeep) is deleting
+    whole files.
+
+        <base>.manifest         one line per segment, oldest first
+        <base>.000001.txt|.bin  ordinary trail logs (trail_log.h)
+
+    Manifest lines:
+
+        # manifest v1
+        <file> <t0> <t1> <points> <minx> <miny> <maxx> <maxy>
+
+    t0/t1 are the wall-clock (unix ns) times of the first and last sample,
+    points counts samples and the box bounds them. The segment being
+    written is listed with t1 = TRAIL_SEGMENT_OPEN until it is closed, so
+    a reader after a crash still finds it. Every segment starts with its
+    own session header and repeats the window definitions seen so far, so
+    each file can be read on its own. With IndexEvery each segment also
+    gets its own .idx sidecar, which the reader uses to jump into the
+    first segment of a time range.
+*/
+
+#ifndef TRAIL_SEGMENTS_H
+#define TRAIL_SEGMENTS_H
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "trail_log.h"
+#include "trail_sample.h"
+
+static const long long TRAIL_SEGMENT_OPEN = 0x7FFFFFFFFFFFFFFFLL;
+
+// How segment files get opened (fopen by default)
+typedef FILE* (*TrailFileOpener)(const char* path, const char* mode);
+
+struct TrailSegmentInfo {
+    std::string file;       // Relative to the manifest's directory
+    long long t0, t1;       // Wall-clock ns
+    unsigned long long points;
+    int minX, minY, maxX, maxY;
+};
+
+class TrailManifest {
+public:
+    // Missing file = empty manifest
+    bool Load(const char* path);
+    // Writes a temp file and renames it over path
+    bool Save(const char* path) const;
+
+    std::vector<TrailSegmentInfo>& Segments() { return m_segments; }
+    const std::vector<TrailSegmentInfo>& Segments() const { return m_segments; }
+
+    // Segments overlapping [fromNs, toNs], oldest first
+    std::vector<size_t> Select(long long fromNs, long long toNs) const;
+
+private:
+    std::vector<TrailSegmentInfo> m_segments;
+};
+
+// Same interface as TrailWriter, over a series of segment files
+class TrailSegmentWriter {
+public:
+    TrailSegmentWriter();
+    ~TrailSegmentWriter();
+
+    // Rotation limits (0 = no limit) and how many closed segments to keep (0 = all)
+    void SetSegmentLimits(int maxMB, int maxMinutes, int keep);
+    // Passed on to every segment's TrailWriter
+    void SetCommitPolicy(int maxSamples, int maxMs, TrailDurability durability);
+    void SetIndexEvery(int everySamples);
+    void SetFileOpener(TrailFileOpener opener);
+
+    // base is the path without extension ("mouse_log"). append keeps the
+    // segments already in the manifest, otherwise they are deleted.
+    bool Open(const char* base, bool append, int intervalMs, TrailFormat format = TRAIL_FORMAT_TEXT,
+              int screenW = 0, int screenH = 0);
+    bool IsOpen() const { return m_writer.IsOpen(); }
+
+    void Append(const TrailSample& s);
+    void WriteWindow(int id, unsigned long long handle, const char* name);
+    // TrailWriter::Flush, then starts a new segment once a limit is reached.
+    // Returns false if the next segment could not be created; logging stays
+    // in the current one and the rotation is retried on the next Flush.
+    bool Flush();
+    void Close();
+
+    // Stats over all segments of this session
+    unsigned long long GetSampleCount() const { return m_samples + (IsOpen() ? m_writer.GetSampleCount() : 0); }
+    unsigned long long GetRecordCount() const { return m_records + (IsOpen() ? m_writer.GetRecordCount() : 0); }
+    unsigned long long GetCommitCount() const { return m_commits + (IsOpen() ? m_writer.GetCommitCount() : 0); }
+    unsigned long long GetSyncCount() const { return m_syncs + (IsOpen() ? m_writer.GetSyncCount() : 0); }
+    unsigned long long GetSegmentCount() const { return m_segmentsOpened; }
+
+private:
+    struct WindowDef {
+        int id;
+        unsigned long long handle;
+        std::string name;
+    };
+
+    bool OpenSegment();
+    FILE* CreateSegmentFile(std::string& path);
+    void StartSegment(FILE* f, const std::string& path);
+    void CloseSegment();
+    void Prune();
+    void RemoveSegment(const std::string& file);
+
+    TrailWriter m_writer;
+    FILE* m_file;           // Owned by m_writer, only for TellFile64
+    std::string m_base, m_manifestPath;
+    TrailManifest m_manifest;
+    unsigned int m_nextIndex;
+
+    int m_intervalMs, m_screenW, m_screenH;
+    TrailFormat m_format;
+    int m_commitSamples, m_commitMs;
+    TrailDurability m_durability;
+    int m_indexEvery;
+    TrailFileOpener m_opener;
+
+    long long m_maxBytes, m_maxNs;
+    int m_keep;
+
+    long long m_wallOffset; // wall - monotonic, fixed per session
+    std::vector<WindowDef> m_windows;
+
+    unsigned long long m_samples, m_records, m_commits, m_syncs, m_segmentsOpened;
+};
+
+// Reads the segments of a manifest overlapping a time range as one log
+class TrailSegmentReader {
+public:
+    TrailSegmentReader();
+
+    // fromNs/toNs are wall-clock ns, samples outside are skipped
+    bool Open(const char* manifestPath, long long fromNs = 0, long long toNs = TRAIL_SEGMENT_OPEN);
+    bool Next(TrailSample& s, long long& count);
+
+    size_t GetSegmentsSelected() const { return m_files.size(); }
+    // Samples listed for the selected segments (an open one counts 0)
+    unsigned long long EstimateRecords() const { return m_estimate; }
+    unsigned long long GetBadBlocks() const { return m_badBlocks + (m_reading ? m_reader.GetBadBlocks() : 0); }
+
+private:
+    bool OpenNext();
+
+    TrailReader m_reader;
+    bool m_reading;
+    std::vector<std::string> m_files;
+    size_t m_next;
+    long long m_from, m_to;
+    unsigned long long m_badBlocks;
+    unsigned long long m_estimate;
+};
+
+// "<base>.manifest"
+std::string TrailManifestPath(const char* base);
+
+#endif
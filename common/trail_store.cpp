@@ -0,0 +1,53 @@
+#include "trail_store.h"
+#include "trail_clock.h"
+
+#include <algorithm>
+
+static const unsigned long long POINT_BYTES = sizeof(TrailPoint) + sizeof(long long);
+
+TrailStore::TrailStore() : m_maxPoints(0), m_complete(false), m_wallNs(0), m_monoNs(0) {}
+
+void TrailStore::SetLimit(unsigned long long maxBytes) {
+    m_maxPoints = (size_t)(maxBytes / POINT_BYTES);
+}
+
+void TrailStore::Begin() {
+    Release();
+    m_complete = m_maxPoints > 0;
+    m_wallNs = GetWallClockNs();
+    m_monoNs = GetMonotonicNs();
+}
+
+void TrailStore::Append(const TrailSample& s) {
+    if (!m_complete) return;
+    if (!m_points.empty() && m_points.back().x == s.x && m_points.back().y == s.y) {
+        m_ends.back() = s.t;
+        return;
+    }
+    if (m_points.size() >= m_maxPoints) {
+        // Over the cap: the log has it all, a partial trail is no use
+        Release();
+        m_complete = false;
+        return;
+    }
+    TrailPoint p = { s.x, s.y };
+    m_points.push_back(p);
+    m_ends.push_back(s.t);
+}
+
+// Same cut as TrailReader::SeekToTime: the run covering fromNs still counts
+void TrailStore::TakePoints(long long fromNs, std::vector<TrailPoint>& out) {
+    size_t first = 0;
+    if (fromNs > 0) {
+        long long t = fromNs - m_wallNs + m_monoNs;
+        first = (size_t)(std::lower_bound(m_ends.begin(), m_ends.end(), t) - m_ends.begin());
+    }
+    if (first == 0 && out.empty()) out.swap(m_points);
+    else out.insert(out.end(), m_points.begin() + first, m_points.end());
+    Release();
+}
+
+void TrailStore::Release() {
+    std::vector<TrailPoint>().swap(m_points);
+    std::vector<long long>().swap(m_ends);
+}
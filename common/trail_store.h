@@ -0,0 +1,50 @@
+/*
+    Trail Store
+    The current session's points, kept in memory as they are logged, so
+    the review after STOP draws from here instead of reading the log back.
+    Like a log load it keeps one point per run: a sample at the same
+    position as the last one only extends that point's time.
+
+    Memory is capped (16 bytes a point); a session that outgrows the cap
+    drops its points and the review reads the log as before. Samples from
+    earlier sessions (AutoClear=0, ring) are only in the log.
+*/
+
+#ifndef TRAIL_STORE_H
+#define TRAIL_STORE_H
+
+#include <stddef.h>
+#include <vector>
+#include "trail_sample.h"
+
+class TrailStore {
+public:
+    TrailStore();
+
+    // 0 keeps nothing (the review always reads the log)
+    void SetLimit(unsigned long long maxBytes);
+    // A new session (START); the last one's points are dropped
+    void Begin();
+    void Append(const TrailSample& s);
+
+    // Holds every point since Begin()
+    bool IsComplete() const { return m_complete; }
+    // When Begin() was called (wall-clock ns)
+    long long GetWallNs() const { return m_wallNs; }
+    size_t GetPointCount() const { return m_points.size(); }
+
+    // Appends the points still current at or after wall-clock fromNs
+    // (0 = all) to out and empties the store
+    void TakePoints(long long fromNs, std::vector<TrailPoint>& out);
+
+private:
+    void Release();
+
+    std::vector<TrailPoint> m_points;
+    std::vector<long long> m_ends; // Time of each point's last sample
+    size_t m_maxPoints;
+    bool m_complete;
+    long long m_wallNs, m_monoNs;
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include "trail_stream.h"
+#include "trail_clock.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char STREAM_MAGIC[4] = { 'M', 'T', 'R', 'S' };
+static const unsigned int STREAM_VERSION = 1;
+
+TrailStreamFormat ParseTrailStreamFormat(const char* name) {
+    return (name && strcmp(name, "text") == 0) ? TRAIL_STREAM_TEXT : TRAIL_STREAM_FRAMED;
+}
+
+TrailStreamFull ParseTrailStreamFull(const char* name) {
+    return (name && strcmp(name, "drop") == 0) ? TRAIL_STREAM_DROP : TRAIL_STREAM_BLOCK;
+}
+
+TrailStream::TrailStream()
+    : m_fd(-1), m_format(TRAIL_STREAM_FRAMED), m_full(TRAIL_STREAM_BLOCK), m_broken(false),
+      m_written(0), m_frameStart(0), m_samples(0), m_dropped(0), m_unreported(0) {}
+
+TrailStream::~TrailStream() {
+    Close();
+}
+
+bool TrailStream::Open(const char* path, TrailStreamFormat format, TrailStreamFull full) {
+    Close();
+    if (strcmp(path, "-") == 0) {
+        fflush(stdout);
+        m_fd = dup(STDOUT_FILENO);
+        if (m_fd >= 0) dup2(STDERR_FILENO, STDOUT_FILENO);
+    } else {
+        m_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if (m_fd < 0) return false;
+
+    signal(SIGPIPE, SIG_IGN); // A reader that quits gives EPIPE instead of killing the tracker
+    if (full == TRAIL_STREAM_DROP) fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) | O_NONBLOCK);
+
+    m_format = format;
+    m_full = full;
+    m_broken = false;
+    m_pending.clear();
+    m_written = 0;
+    if (m_format == TRAIL_STREAM_FRAMED) {
+        m_pending.insert(m_pending.end(), STREAM_MAGIC, STREAM_MAGIC + 4);
+        m_pending.push_back((char)STREAM_VERSION);
+        m_pending.push_back(0);
+        m_pending.push_back(0);
+        m_pending.push_back(0);
+    }
+    return true;
+}
+
+// Even when dropping, the reader should get the end of the last frame
+void TrailStream::Close() {
+    if (m_fd < 0) return;
+    WritePending(m_full == TRAIL_STREAM_BLOCK ? -1 : CLOSE_WAIT_MS);
+    close(m_fd);
+    m_fd = -1;
+}
+
+void TrailStream::PutU32(unsigned int v) {
+    for (int i = 0; i < 4; ++i) m_pending.push_back((char)(v >> (8 * i)));
+}
+
+void TrailStream::PutU64(unsigned long long v) {
+    for (int i = 0; i < 8; ++i) m_pending.push_back((char)(v >> (8 * i)));
+}
+
+void TrailStream::BeginFrame(char type) {
+    m_frameStart = m_pending.size();
+    PutU32(0); // Length, patched by EndFrame
+    m_pending.push_back(type);
+}
+
+void TrailStream::EndFrame() {
+    unsigned int len = (unsigned int)(m_pending.size() - m_frameStart - 4);
+    for (int i = 0; i < 4; ++i) m_pending[m_frameStart + i] = (char)(len >> (8 * i));
+}
+
+void TrailStream::Begin(int intervalMs, int screenW, int screenH) {
+    m_samples = m_dropped = m_unreported = 0;
+    if (m_fd < 0 || m_broken) return;
+
+    long long mono = GetMonotonicNs();
+    long long wall = GetWallClockNs();
+    if (m_format == TRAIL_STREAM_FRAMED) {
+        BeginFrame('H');
+        PutU32((unsigned int)screenW);
+        PutU32((unsigned int)screenH);
+        PutU32((unsigned int)intervalMs);
+        PutU64((unsigned long long)wall);
+        PutU64((unsigned long long)mono);
+        EndFrame();
+    } else {
+        char line[160];
+        int n = snprintf(line, sizeof(line), "# session wall_ns=%lld mono_ns=%lld interval_ms=%d screen=%dx%d\n",
+                         wall, mono, intervalMs, screenW, screenH);
+        m_pending.insert(m_pending.end(), line, line + n);
+    }
+    Flush();
+}
+
+// Blocking always has room; dropping only while the backlog is small
+bool TrailStream::Room() {
+    return m_full == TRAIL_STREAM_BLOCK || m_pending.size() - m_written < PENDING_LIMIT;
+}
+
+void TrailStream::Append(const TrailSample& s) {
+    if (m_fd < 0 || m_broken) return;
+    if (!Room()) {
+        m_dropped++;
+        m_unreported++;
+        return;
+    }
+
+    // The gap is reported where it happened
+    if (m_unreported > 0) {
+        if (m_format == TRAIL_STREAM_FRAMED) {
+            BeginFrame('D');
+            PutU64(m_unreported);
+            EndFrame();
+        } else {
+            char line[48];
+            int n = snprintf(line, sizeof(line), "# dropped %llu\n", m_unreported);
+            m_pending.insert(m_pending.end(), line, line + n);
+        }
+        m_unreported = 0;
+    }
+
+    if (m_format == TRAIL_STREAM_FRAMED) {
+        BeginFrame('S');
+        PutU64((unsigned long long)s.t);
+        PutU32((unsigned int)s.x);
+        PutU32((unsigned int)s.y);
+        PutU32(s.buttons);
+        PutU32((unsigned int)s.window);
+        EndFrame();
+    } else {
+        char line[96];
+        int n = (s.buttons || s.window) ?
+            snprintf(line, sizeof(line), "%d,%d,%lld,1,%u,%d\n", s.x, s.y, s.t, s.buttons, s.window) :
+            snprintf(line, sizeof(line), "%d,%d,%lld\n", s.x, s.y, s.t);
+        m_pending.insert(m_pending.end(), line, line + n);
+    }
+    m_samples++;
+}
+
+// Never dropped: samples that follow may refer to it
+void TrailStream::WriteWindow(int id, unsigned long long handle, const char* name) {
+    if (m_fd < 0 || m_broken) return;
+    if (!name) name = "";
+
+    if (m_format == TRAIL_STREAM_FRAMED) {
+        BeginFrame('W');
+        PutU32((unsigned int)id);
+        PutU64(handle);
+        m_pending.insert(m_pending.end(), name, name + strlen(name));
+        EndFrame();
+        return;
+    }
+    char line[64];
+    int n = snprintf(line, sizeof(line), "# window %d 0x%llx ", id, handle);
+    m_pending.insert(m_pending.end(), line, line + n);
+    m_pending.insert(m_pending.end(), name, name + strlen(name));
+    m_pending.push_back('\n');
+}
+
+void TrailStream::Flush() {
+    if (m_fd < 0) return;
+    WritePending(m_full == TRAIL_STREAM_BLOCK ? -1 : 0);
+}
+
+void TrailStream::End() {
+    if (m_fd < 0 || m_broken) return;
+
+    if (m_format == TRAIL_STREAM_FRAMED) {
+        BeginFrame('E');
+        PutU64(m_samples);
+        PutU64(m_dropped);
+        EndFrame();
+    } else {
+        char line[96];
+        int n = snprintf(line, sizeof(line), "# end samples=%llu dropped=%llu\n", m_samples, m_dropped);
+        m_pending.insert(m_pending.end(), line, line + n);
+    }
+    Flush();
+}
+
+// waitMs: how long to wait for the reader each time the pipe is full (-1 = as long as it takes)
+void TrailStream::WritePending(int waitMs) {
+    while (!m_broken && m_written < m_pending.size()) {
+        ssize_t n = write(m_fd, &m_pending[m_written], m_pending.size() - m_written);
+        if (n > 0) {
+            m_written += (size_t)n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd pfd = { m_fd, POLLOUT, 0 };
+            if (waitMs == 0 || poll(&pfd, 1, waitMs) == 0) break;
+        } else {
+            m_broken = true; // EPIPE: the reader is gone
+        }
+    }
+
+    if (m_broken || m_written == m_pending.size()) {
+        m_pending.clear();
+        m_written = 0;
+    } else if (m_written >= PENDING_LIMIT) {
+        // A partly written frame stays at the front
+        m_pending.erase(m_pending.begin(), m_pending.begin() + m_written);
+        m_written = 0;
+    }
+}
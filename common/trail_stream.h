@@ -0,0 +1,101 @@
+/*
+    Trail Stream
+    Live sample output to stdout or a named FIFO (--output), for piping
+    into other tools instead of writing a log and parsing it back. Unlike
+    the log, every sample goes out as soon as the logger flushes, with no
+    run-length holdback. POSIX only (the Linux frontends).
+
+    Framed format (StreamFormat=framed), all integers little-endian:
+
+        stream  "MTRS" u16 version, u16 reserved, then frames
+        frame   u32 length (of type + body), u8 type, body
+        'H'     i32 screen w, i32 screen h, i32 interval_ms, i64 wall_ns,
+                i64 mono_ns: a session starts (one per START)
+        'S'     i64 t, i32 x, i32 y, u32 buttons, i32 window
+        'W'     i32 id, u64 handle, title bytes
+        'D'     u64 samples dropped just before this frame (StreamFull=drop)
+        'E'     u64 samples, u64 dropped: the session ended (STOP)
+
+    Unknown frame types can be skipped by their length. Text format
+    (StreamFormat=text) uses the log's lines (see trail_log.h), one sample
+    per line, plus "# dropped <n>" and "# end samples=<n> dropped=<n>", so
+    ParseTrailLine() reads it.
+
+    When the reader falls behind, StreamFull=block makes the logger thread
+    wait for it (samples queue in memory meanwhile, capture never stalls),
+    and StreamFull=drop throws away whole samples once PENDING_LIMIT bytes
+    are waiting, counting them. A reader that goes away ends the stream;
+    the tracker keeps running.
+*/
+
+#ifndef TRAIL_STREAM_H
+#define TRAIL_STREAM_H
+
+#include <string>
+#include <vector>
+#include "trail_sample.h"
+
+enum TrailStreamFormat {
+    TRAIL_STREAM_FRAMED,
+    TRAIL_STREAM_TEXT
+};
+
+enum TrailStreamFull {
+    TRAIL_STREAM_BLOCK,
+    TRAIL_STREAM_DROP
+};
+
+class TrailStream {
+public:
+    TrailStream();
+    ~TrailStream();
+
+    // "-" is stdout, which then moves to a private fd: stdout itself is
+    // pointed at stderr, so printf() output can't end up in the stream.
+    // Anything else is opened for writing (a FIFO waits for its reader).
+    bool Open(const char* path, TrailStreamFormat format, TrailStreamFull full);
+    void Close();
+    bool IsOpen() const { return m_fd >= 0; }
+    // The reader went away; nothing more is written
+    bool IsBroken() const { return m_broken; }
+
+    // One session, between START and STOP
+    void Begin(int intervalMs, int screenW, int screenH);
+    void Append(const TrailSample& s);
+    void WriteWindow(int id, unsigned long long handle, const char* name);
+    // Writes what is pending (all of it when blocking, what fits when dropping)
+    void Flush();
+    void End();
+
+    // This session's
+    unsigned long long GetSampleCount() const { return m_samples; }
+    unsigned long long GetDroppedCount() const { return m_dropped; }
+
+private:
+    static const size_t PENDING_LIMIT = 256 * 1024;
+    static const int CLOSE_WAIT_MS = 1000; // Dropping: how long Close() waits per write
+
+    bool Room();
+    void BeginFrame(char type);
+    void EndFrame();
+    void PutU32(unsigned int v);
+    void PutU64(unsigned long long v);
+    void WritePending(int waitMs);
+
+    int m_fd;
+    TrailStreamFormat m_format;
+    TrailStreamFull m_full;
+    bool m_broken;
+    std::vector<char> m_pending; // Whole frames/lines not yet written
+    size_t m_written;            // Bytes of m_pending already out
+    size_t m_frameStart;
+    unsigned long long m_samples, m_dropped;
+    unsigned long long m_unreported; // Dropped since the last 'D' frame
+};
+
+// "text" -> TRAIL_STREAM_TEXT, anything else is framed
+TrailStreamFormat ParseTrailStreamFormat(const char* name);
+// "drop" -> TRAIL_STREAM_DROP, anything else blocks
+TrailStreamFull ParseTrailStreamFull(const char* name);
+
+#endif
@@ -0,0 +1,42 @@
+#include "trail_view.h"
+
+TrailPointView::TrailPointView() : m_open(false), m_marked(false) {}
+
+bool TrailPointView::Open(FILE* f) {
+    Close();
+    if (!m_reader.Open(f)) return false;
+    if (!m_reader.IsRing() && !(m_reader.IsBinary() && m_reader.IsMapped())) {
+        m_reader.Close();
+        return false;
+    }
+    m_open = true;
+    m_batch.reserve(BATCH);
+    return true;
+}
+
+void TrailPointView::Close() {
+    m_reader.Close();
+    m_open = false;
+    m_marked = false;
+    std::vector<TrailPoint>().swap(m_batch);
+}
+
+// The first pass marks the start the reader was positioned at
+bool TrailPointView::Rewind() {
+    if (!m_open) return false;
+    if (!m_marked) return m_marked = m_reader.SetMark();
+    return m_reader.ReturnToMark();
+}
+
+size_t TrailPointView::Next(const TrailPoint*& points) {
+    m_batch.clear();
+    TrailSample s;
+    long long count;
+    // A run of n identical samples draws as a single vertex
+    while (m_batch.size() < BATCH && m_open && m_reader.Next(s, count)) {
+        TrailPoint p = { s.x, s.y };
+        m_batch.push_back(p);
+    }
+    points = m_batch.empty() ? NULL : &m_batch[0];
+    return m_batch.size();
+}
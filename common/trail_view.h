@@ -0,0 +1,53 @@
+/*
+    Trail View
+    A review's points read straight from the log on every pass instead of
+    copied into a vector once. Binary logs are memory-mapped and each
+    sample block is checked and decoded in place into a small batch, so
+    a long session costs its page cache plus one batch, and opening costs
+    only the seek to the review's start (footer or index), whatever the
+    file size. Rings are read in fixed-size chunks the same way.
+
+    The view is sequential, not random access: binary records are
+    delta-coded varints with no fixed stride to index into, so a pass goes
+    front to back from the review's start, a batch at a time, and there is
+    no point(i). A frontend that redraws often renders one pass into its own
+    cache (the Hyprland review draws a cairo surface on its load thread).
+    Text logs aren't viewed; they load into a vector (TrailReader::ReadPoints).
+*/
+
+#ifndef TRAIL_VIEW_H
+#define TRAIL_VIEW_H
+
+#include <stdio.h>
+#include <vector>
+#include "trail_log.h"
+
+class TrailPointView {
+public:
+    TrailPointView();
+
+    // Takes ownership of f. False (f closed) unless it is a binary log
+    // that could be mapped or a ring.
+    bool Open(FILE* f);
+    void Close();
+    bool IsOpen() const { return m_open; }
+
+    // Position it (OpenIndex + SeekToTime, SeekToLastSession) right after
+    // Open; every pass starts where the first one did
+    TrailReader& GetReader() { return m_reader; }
+
+    // One pass, oldest first: Rewind(), then Next() until it returns 0.
+    // A batch stays valid until the next call.
+    bool Rewind();
+    size_t Next(const TrailPoint*& points);
+
+private:
+    static const size_t BATCH = 4096;
+
+    TrailReader m_reader;
+    bool m_open;
+    bool m_marked;
+    std::vector<TrailPoint> m_batch;
+};
+
+#endif
@@ -0,0 +1,385 @@
+#include "uring_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// No liburing dependency: the three syscalls are all we need
+static int UringSetup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static std::atomic<unsigned long long> g_uringEnters(0);
+
+static int UringEnter(int ring, unsigned submit, unsigned wait, unsigned flags) {
+    g_uringEnters.fetch_add(1, std::memory_order_relaxed);
+    return (int)syscall(__NR_io_uring_enter, ring, submit, wait, flags, NULL, 0);
+}
+
+static int UringRegister(int ring, unsigned op, void* arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, ring, op, arg, count);
+}
+
+class UringFile {
+public:
+    static const int BUFFERS = 4;
+    static const size_t BUFFER_SIZE = 256 * 1024;
+    static const size_t ALIGN = 4096; // O_DIRECT offset/length granularity
+
+    UringFile();
+    ~UringFile();
+
+    bool Open(const char* path, bool append, bool direct);
+    ssize_t Write(const char* data, size_t size);
+    bool Seek(off64_t* offset, int whence);
+    bool Sync();
+    int Close();
+
+    FILE* stream;
+
+private:
+    bool SetupRing();
+    int AcquireBuffer();
+    void Submit(int buf, size_t len, long long offset);
+    void Reap(bool wait);
+    void Drain();
+    void WriteTail();
+
+    int m_fd, m_ring;
+    bool m_direct, m_fixed, m_error;
+
+    // Rings, as mapped from the kernel
+    void* m_sqMap;
+    void* m_cqMap;
+    size_t m_sqMapSize, m_cqMapSize;
+    struct io_uring_sqe* m_sqes;
+    size_t m_sqesSize;
+    unsigned *m_sqHead, *m_sqTail, *m_sqMask, *m_sqArray;
+    unsigned *m_cqHead, *m_cqTail, *m_cqMask;
+    struct io_uring_cqe* m_cqes;
+
+    unsigned char* m_buffers[BUFFERS];
+    bool m_busy[BUFFERS];
+    size_t m_len[BUFFERS];
+    long long m_off[BUFFERS];
+    int m_inFlight;
+
+    long long m_offset;    // Logical end of file
+    // O_DIRECT only: buffer being filled and its (aligned) file offset
+    int m_current;
+    size_t m_fill;
+    long long m_bufOffset;
+};
+
+UringFile::UringFile()
+    : stream(NULL), m_fd(-1), m_ring(-1), m_direct(false), m_fixed(false), m_error(false),
+      m_sqMap(MAP_FAILED), m_cqMap(MAP_FAILED), m_sqMapSize(0), m_cqMapSize(0),
+      m_sqes((struct io_uring_sqe*)MAP_FAILED), m_sqesSize(0),
+      m_sqHead(NULL), m_sqTail(NULL), m_sqMask(NULL), m_sqArray(NULL),
+      m_cqHead(NULL), m_cqTail(NULL), m_cqMask(NULL), m_cqes(NULL),
+      m_inFlight(0), m_offset(0), m_current(-1), m_fill(0), m_bufOffset(0) {
+    for (int i = 0; i < BUFFERS; ++i) {
+        m_buffers[i] = NULL;
+        m_busy[i] = false;
+    }
+}
+
+UringFile::~UringFile() {
+    for (int i = 0; i < BUFFERS; ++i) free(m_buffers[i]);
+    if (m_sqes != MAP_FAILED) munmap(m_sqes, m_sqesSize);
+    if (m_cqMap != MAP_FAILED && m_cqMap != m_sqMap) munmap(m_cqMap, m_cqMapSize);
+    if (m_sqMap != MAP_FAILED) munmap(m_sqMap, m_sqMapSize);
+    if (m_ring >= 0) close(m_ring);
+    if (m_fd >= 0) close(m_fd);
+}
+
+bool UringFile::SetupRing() {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    m_ring = UringSetup(BUFFERS * 2, &p);
+    if (m_ring < 0) return false;
+
+    m_sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    m_cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single && m_cqMapSize > m_sqMapSize) m_sqMapSize = m_cqMapSize;
+
+    m_sqMap = mmap(NULL, m_sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQ_RING);
+    if (m_sqMap == MAP_FAILED) return false;
+    m_cqMap = single ? m_sqMap :
+              mmap(NULL, m_cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_CQ_RING);
+    if (m_cqMap == MAP_FAILED) return false;
+    m_sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+    m_sqes = (struct io_uring_sqe*)mmap(NULL, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                        m_ring, IORING_OFF_SQES);
+    if (m_sqes == MAP_FAILED) return false;
+
+    char* sq = (char*)m_sqMap;
+    char* cq = (char*)m_cqMap;
+    m_sqHead = (unsigned*)(sq + p.sq_off.head);
+    m_sqTail = (unsigned*)(sq + p.sq_off.tail);
+    m_sqMask = (unsigned*)(sq + p.sq_off.ring_mask);
+    m_sqArray = (unsigned*)(sq + p.sq_off.array);
+    m_cqHead = (unsigned*)(cq + p.cq_off.head);
+    m_cqTail = (unsigned*)(cq + p.cq_off.tail);
+    m_cqMask = (unsigned*)(cq + p.cq_off.ring_mask);
+    m_cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+    struct iovec iov[BUFFERS];
+    for (int i = 0; i < BUFFERS; ++i) {
+        if (posix_memalign((void**)&m_buffers[i], ALIGN, BUFFER_SIZE) != 0) return false;
+        iov[i].iov_base = m_buffers[i];
+        iov[i].iov_len = BUFFER_SIZE;
+    }
+    // Pinning can fail under a low RLIMIT_MEMLOCK; plain writes from the same buffers still work
+    m_fixed = UringRegister(m_ring, IORING_REGISTER_BUFFERS, iov, BUFFERS) == 0;
+    return true;
+}
+
+bool UringFile::Open(const char* path, bool append, bool direct) {
+    m_direct = direct;
+    int flags = O_RDWR | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC) | (direct ? O_DIRECT : 0);
+    m_fd = open(path, flags, 0644);
+    if (m_fd < 0 || !SetupRing()) return false;
+
+    struct stat st;
+    if (fstat(m_fd, &st) != 0) return false;
+    m_offset = st.st_size;
+
+    if (m_direct) {
+        // Continue from the aligned block holding the old end of file
+        m_current = AcquireBuffer();
+        m_bufOffset = m_offset & ~(long long)(ALIGN - 1);
+        m_fill = (size_t)(m_offset - m_bufOffset);
+        if (m_fill > 0 && pread(m_fd, m_buffers[m_current], ALIGN, m_bufOffset) < (ssize_t)m_fill) return false;
+    }
+    return true;
+}
+
+int UringFile::AcquireBuffer() {
+    for (;;) {
+        for (int i = 0; i < BUFFERS; ++i) {
+            if (!m_busy[i] && i != m_current) return i;
+        }
+        Reap(true);
+    }
+}
+
+void UringFile::Submit(int buf, size_t len, long long offset) {
+    unsigned tail = *m_sqTail;
+    unsigned index = tail & *m_sqMask;
+    struct io_uring_sqe* sqe = &m_sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = m_fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = m_fd;
+    sqe->addr = (unsigned long long)(uintptr_t)m_buffers[buf];
+    sqe->len = (unsigned)len;
+    sqe->off = (unsigned long long)offset;
+    sqe->buf_index = (unsigned short)(m_fixed ? buf : 0);
+    sqe->user_data = (unsigned long long)buf;
+    m_sqArray[index] = index;
+    __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    m_busy[buf] = true;
+    m_len[buf] = len;
+    m_off[buf] = offset;
+    m_inFlight++;
+    int submitted;
+    while ((submitted = UringEnter(m_ring, 1, 0, 0)) < 0 && errno == EINTR) {}
+    if (submitted > 0 || __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE) != tail) return;
+
+    // Not taken (EAGAIN, EBUSY, ENOMEM...): no completion will ever come, so
+    // take the entry back and write the buffer here. The error still sticks.
+    __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+    m_busy[buf] = false;
+    m_inFlight--;
+    m_error = true;
+    ssize_t written = pwrite(m_fd, m_buffers[buf], len, offset);
+    (void)written;
+}
+
+void UringFile::Reap(bool wait) {
+    unsigned head = *m_cqHead;
+    if (wait && head == __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE) && m_inFlight > 0) {
+        while (UringEnter(m_ring, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno == EINTR) {}
+    }
+
+    unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+        const struct io_uring_cqe& cqe = m_cqes[head & *m_cqMask];
+        int buf = (int)cqe.user_data;
+        // A short write finishes synchronously, an error sticks until fclose reports it
+        if (cqe.res < 0) {
+            m_error = true;
+        } else if ((size_t)cqe.res < m_len[buf]) {
+            size_t done = (size_t)cqe.res;
+            if (pwrite(m_fd, m_buffers[buf] + done, m_len[buf] - done, m_off[buf] + done) != (ssize_t)(m_len[buf] - done)) {
+                m_error = true;
+            }
+        }
+        m_busy[buf] = false;
+        m_inFlight--;
+    }
+    __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+}
+
+void UringFile::Drain() {
+    while (m_inFlight > 0) Reap(true);
+}
+
+ssize_t UringFile::Write(const char* data, size_t size) {
+    if (m_error) {
+        errno = EIO;
+        return -1;
+    }
+
+    size_t left = size;
+    while (left > 0) {
+        if (!m_direct) {
+            // Each flush from stdio goes out right away, as write() would
+            int buf = AcquireBuffer();
+            size_t n = left < BUFFER_SIZE ? left : BUFFER_SIZE;
+            memcpy(m_buffers[buf], data, n);
+            Submit(buf, n, m_offset);
+            m_offset += n;
+            data += n;
+            left -= n;
+            continue;
+        }
+
+        size_t n = BUFFER_SIZE - m_fill;
+        if (n > left) n = left;
+        memcpy(m_buffers[m_current] + m_fill, data, n);
+        m_fill += n;
+        m_offset += n;
+        data += n;
+        left -= n;
+        if (m_fill == BUFFER_SIZE) {
+            Submit(m_current, BUFFER_SIZE, m_bufOffset);
+            m_bufOffset += BUFFER_SIZE;
+            m_current = AcquireBuffer();
+            m_fill = 0;
+        }
+    }
+    Reap(false); // Free whatever finished meanwhile, never blocks
+    return (ssize_t)size;
+}
+
+// O_DIRECT: the partial buffer goes out padded to ALIGN, then the file is cut back to its real size
+void UringFile::WriteTail() {
+    if (!m_direct || m_fill == 0) return;
+    size_t padded = (m_fill + ALIGN - 1) & ~(ALIGN - 1);
+    memset(m_buffers[m_current] + m_fill, 0, padded - m_fill);
+    Submit(m_current, padded, m_bufOffset);
+    Drain(); // The buffer keeps filling afterwards, the kernel must be done with it
+    if (ftruncate(m_fd, m_offset) != 0) m_error = true;
+}
+
+bool UringFile::Seek(off64_t* offset, int whence) {
+    // Append only: ftell() and seeks to the end are all TrailWriter needs
+    if ((whence == SEEK_CUR || whence == SEEK_END) && *offset == 0) {
+        *offset = m_offset;
+        return true;
+    }
+    if (whence == SEEK_SET && *offset == m_offset) return true;
+    errno = ESPIPE;
+    return false;
+}
+
+bool UringFile::Sync() {
+    WriteTail();
+    Drain();
+    return fdatasync(m_fd) == 0 && !m_error;
+}
+
+int UringFile::Close() {
+    WriteTail();
+    Drain();
+    return m_error ? -1 : 0;
+}
+
+// Registry, so SyncUringFile can find the object behind a FILE
+static std::mutex g_uringLock;
+static std::vector<UringFile*> g_uringFiles;
+
+static UringFile* FindUringFile(FILE* f) {
+    std::lock_guard<std::mutex> guard(g_uringLock);
+    for (size_t i = 0; i < g_uringFiles.size(); ++i) {
+        if (g_uringFiles[i]->stream == f) return g_uringFiles[i];
+    }
+    return NULL;
+}
+
+static ssize_t CookieWrite(void* cookie, const char* data, size_t size) {
+    return ((UringFile*)cookie)->Write(data, size);
+}
+
+static int CookieSeek(void* cookie, off64_t* offset, int whence) {
+    return ((UringFile*)cookie)->Seek(offset, whence) ? 0 : -1;
+}
+
+static int CookieClose(void* cookie) {
+    UringFile* u = (UringFile*)cookie;
+    {
+        std::lock_guard<std::mutex> guard(g_uringLock);
+        for (size_t i = 0; i < g_uringFiles.size(); ++i) {
+            if (g_uringFiles[i] == u) {
+                g_uringFiles.erase(g_uringFiles.begin() + i);
+                break;
+            }
+        }
+    }
+    int result = u->Close();
+    delete u;
+    return result;
+}
+
+FILE* OpenUringFile(const char* path, const char* mode, bool direct) {
+    bool append = mode && mode[0] == 'a';
+
+    UringFile* u = new UringFile();
+    if (!u->Open(path, append, direct)) {
+        delete u;
+        return fopen(path, mode); // Plain write() path
+    }
+
+    cookie_io_functions_t io;
+    memset(&io, 0, sizeof(io));
+    io.write = CookieWrite;
+    io.seek = CookieSeek;
+    io.close = CookieClose;
+    u->stream = fopencookie(u, "w", io);
+    if (!u->stream) {
+        delete u;
+        return fopen(path, mode);
+    }
+
+    std::lock_guard<std::mutex> guard(g_uringLock);
+    g_uringFiles.push_back(u);
+    return u->stream;
+}
+
+bool IsUringFile(FILE* f) {
+    return FindUringFile(f) != NULL;
+}
+
+bool SyncUringFile(FILE* f) {
+    UringFile* u = FindUringFile(f);
+    if (!u) return false;
+    u->Sync();
+    return true;
+}
+
+unsigned long long GetUringEnterCount() {
+    return g_uringEnters.load(std::memory_order_relaxed);
+}
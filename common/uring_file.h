@@ -0,0 +1,39 @@
+/*
+    Uring File
+    Optional Linux log backend (LogBackend=uring). The log stays a stdio
+    FILE (fopencookie), so TrailWriter needs no changes, but what stdio
+    hands down on a flush is copied into one of a few page-aligned buffers
+    registered with io_uring and submitted as a fixed-buffer write. The
+    logger thread then goes on without waiting for the kernel to copy the
+    data out; it only blocks when every buffer is still in flight.
+
+    direct (LogDirect=1) opens the file with O_DIRECT and only writes whole
+    aligned buffers, bypassing the page cache. The partial last buffer then
+    reaches the disk on a sync (Durability=batch/every) or at fclose, so
+    without a Durability setting a crash can lose up to one buffer.
+
+    Writes only ever append; ftell() works, other seeks fail. When io_uring
+    is not available (old kernel, seccomp, a container that blocks it) or
+    O_DIRECT is refused, a plain fopen() FILE is returned instead, which
+    uses write() as before.
+*/
+
+#ifndef URING_FILE_H
+#define URING_FILE_H
+
+#include <stdio.h>
+
+// mode is "wb"/"w" (truncate) or "ab"/"a" (append)
+FILE* OpenUringFile(const char* path, const char* mode, bool direct);
+
+// True if f came from OpenUringFile with io_uring active
+bool IsUringFile(FILE* f);
+
+// For a FILE from OpenUringFile: waits for the writes in flight and
+// fdatasyncs. False (and nothing done) for any other FILE.
+bool SyncUringFile(FILE* f);
+
+// io_uring_enter calls made by all uring files so far (for benchmarks)
+unsigned long long GetUringEnterCount();
+
+#endif
@@ -0,0 +1,40 @@
+#include "window_table.h"
+
+int WindowTable::Intern(unsigned long long handle, const char* name) {
+    std::lock_guard<std::mutex> guard(m_lock);
+
+    std::unordered_map<unsigned long long, int>::iterator it = m_ids.find(handle);
+    if (it != m_ids.end()) return it->second;
+
+    Entry e;
+    e.handle = handle;
+    e.name = name ? name : "";
+    // One record per line in the text log
+    for (size_t i = 0; i < e.name.size(); ++i) {
+        if (e.name[i] == '\n' || e.name[i] == '\r') e.name[i] = ' ';
+    }
+
+    m_entries.push_back(e);
+    int id = (int)m_entries.size();
+    m_ids[handle] = id;
+    return id;
+}
+
+bool WindowTable::Get(int id, unsigned long long& handle, std::string& name) const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    if (id < 1 || id > (int)m_entries.size()) return false;
+    handle = m_entries[id - 1].handle;
+    name = m_entries[id - 1].name;
+    return true;
+}
+
+int WindowTable::Size() const {
+    std::lock_guard<std::mutex> guard(m_lock);
+    return (int)m_entries.size();
+}
+
+void WindowTable::Clear() {
+    std::lock_guard<std::mutex> guard(m_lock);
+    m_ids.clear();
+    m_entries.clear();
+}
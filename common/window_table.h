@@ -0,0 +1,42 @@
+/*
+    Window Table
+    Interns the windows a session's cursor passes over. Each window is
+    looked up once (native handle + title) and gets a small ID, so samples
+    carry that integer instead of a string and the log can attribute cursor
+    time to applications without a lookup per sample.
+
+    IDs start at 1 and grow by one per new window; 0 means no window
+    (desktop / unknown). The capture thread interns while the writer reads,
+    so every call takes a lock. Capture code is expected to cache
+    handle -> ID on its side and only call Intern() on a miss.
+*/
+
+#ifndef WINDOW_TABLE_H
+#define WINDOW_TABLE_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class WindowTable {
+public:
+    // Returns the existing ID for handle, or adds it with name
+    int Intern(unsigned long long handle, const char* name);
+
+    bool Get(int id, unsigned long long& handle, std::string& name) const;
+    int Size() const;
+    void Clear();
+
+private:
+    struct Entry {
+        unsigned long long handle;
+        std::string name;
+    };
+
+    mutable std::mutex m_lock;
+    std::unordered_map<unsigned long long, int> m_ids;
+    std::vector<Entry> m_entries;
+};
+
+#endif
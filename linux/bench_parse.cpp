@@ -0,0 +1,132 @@
+/*
+ * Review loader benchmark
+ *
+ * Times the ways a review can load a text log's points:
+ *   fgets + sscanf   the loaders before TrailReader (no reserve)
+ *   Next()           TrailReader on the mapped log, reserved from EstimateRecords
+ *   ReadPoints(1)    the chunked scan on one thread
+ *   ReadPoints(N)    the same on every core (LoadThreads=0)
+ * and prints each one's best of five runs (taken in rounds of all four) and
+ * its speedup over fgets + sscanf.
+ *
+ * Usage:
+ *   ./bench_parse <log>                     (an existing text log)
+ *   ./bench_parse --gen <lines> <log>       (write a synthetic one first)
+ *
+ * Compile:
+ * g++ -O2 -o bench_parse bench_parse.cpp ../common/trail_log.cpp ../common/trail_columns.cpp ../common/mapped_file.cpp ../common/uring_file.cpp -I../common -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "trail_clock.h"
+#include "trail_log.h"
+
+const int RUNS = 5;
+
+// A wandering cursor with a pause now and then, so runs are in the log too
+void Generate(const char* path, long long lines) {
+    TrailWriter writer;
+    writer.Open(fopen(path, "wb"), 10, TRAIL_FORMAT_TEXT, 1920, 1080);
+    long long t = 3049662552946LL;
+    int x = 960, y = 540;
+    srand(2);
+    for (long long i = 0; i < lines; ++i) {
+        int repeats = i % 50 == 0 ? 3 : 1;
+        x = (x + rand() % 21 - 10 + 1920) % 1920;
+        y = (y + rand() % 21 - 10 + 1080) % 1080;
+        for (int k = 0; k < repeats; ++k) {
+            TrailSample s;
+            s.t = t;
+            s.x = x;
+            s.y = y;
+            writer.Append(s);
+            t += 10000000LL;
+        }
+    }
+    writer.Close();
+}
+
+size_t LoadSscanf(const char* path) {
+    std::vector<TrailPoint> points;
+    FILE* f = fopen(path, "r");
+    if (!f) return 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        TrailPoint p;
+        if (sscanf(line, "%d,%d", &p.x, &p.y) == 2) points.push_back(p);
+    }
+    fclose(f);
+    return points.size();
+}
+
+size_t LoadNext(const char* path) {
+    std::vector<TrailPoint> points;
+    TrailReader reader;
+    if (!reader.Open(fopen(path, "rb"))) return 0;
+    points.reserve(reader.EstimateRecords());
+    TrailSample s;
+    long long count;
+    while (reader.Next(s, count)) {
+        TrailPoint p = { s.x, s.y };
+        points.push_back(p);
+    }
+    return points.size();
+}
+
+size_t LoadParallel(const char* path, int threads) {
+    std::vector<TrailPoint> points;
+    TrailReader reader;
+    if (!reader.Open(fopen(path, "rb")) || !reader.ReadPoints(points, threads, 0)) return 0;
+    return points.size();
+}
+
+// One timed load, in seconds
+template <class Load>
+double Time(Load load, size_t& points) {
+    long long t0 = GetMonotonicNs();
+    points = load();
+    return (GetMonotonicNs() - t0) / 1e9;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 4 && strcmp(argv[1], "--gen") == 0) {
+        Generate(argv[3], atoll(argv[2]));
+        argv += 2;
+    } else if (argc != 2) {
+        printf("Usage: bench_parse <log> | --gen <lines> <log>\n");
+        return 1;
+    }
+    const char* path = argv[1];
+    int cores = (int)std::thread::hardware_concurrency();
+
+    // Each round runs every loader, so a busy stretch of the machine hits
+    // them all rather than skewing one ratio
+    const int LOADERS = 4;
+    double best[LOADERS];
+    size_t n[LOADERS];
+    for (int run = 0; run < RUNS; ++run) {
+        double seconds[LOADERS];
+        seconds[0] = Time([&] { return LoadSscanf(path); }, n[0]);
+        seconds[1] = Time([&] { return LoadNext(path); }, n[1]);
+        seconds[2] = Time([&] { return LoadParallel(path, 1); }, n[2]);
+        seconds[3] = Time([&] { return LoadParallel(path, 0); }, n[3]);
+        for (int i = 0; i < LOADERS; ++i) {
+            if (run == 0 || seconds[i] < best[i]) best[i] = seconds[i];
+        }
+    }
+
+    char label[32];
+    snprintf(label, sizeof(label), "ReadPoints(%d)", cores);
+    const char* names[LOADERS] = { "fgets + sscanf", "Next()", "ReadPoints(1)", label };
+    printf("%-16s %10zu points %8.0f ms\n", names[0], n[0], best[0] * 1e3);
+    for (int i = 1; i < LOADERS; ++i) {
+        printf("%-16s %10zu points %8.0f ms %6.1fx\n", names[i], n[i], best[i] * 1e3, best[0] / best[i]);
+    }
+    if (n[1] != n[0] || n[2] != n[0] || n[3] != n[0]) printf("Point counts differ!\n");
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "evdev_source.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+#define BITS_PER_LONG (sizeof(long) * 8)
+#define NLONGS(x) (((x) + BITS_PER_LONG - 1) / BITS_PER_LONG)
+#define TEST_BIT(bit, arr) ((arr[(bit) / BITS_PER_LONG] >> ((bit) % BITS_PER_LONG)) & 1)
+
+EvdevSource::EvdevSource()
+    : m_fd(-1), m_recording(false), m_screenW(1920), m_screenH(1080),
+      m_x(960), m_y(540), m_lastX(-1), m_lastY(-1),
+      m_absMinX(0), m_absMaxX(32767), m_absMinY(0), m_absMaxY(32767),
+      m_moved(false), m_events(0) {
+    m_name[0] = 0;
+}
+
+EvdevSource::~EvdevSource() {
+    Close();
+}
+
+void EvdevSource::SetScreen(int w, int h) {
+    m_screenW = w;
+    m_screenH = h;
+    SetPosition(w / 2, h / 2);
+}
+
+void EvdevSource::SetPosition(int x, int y) {
+    m_x = x;
+    m_y = y;
+}
+
+void EvdevSource::SetAbsRange(int minX, int maxX, int minY, int maxY) {
+    m_absMinX = minX;
+    m_absMaxX = maxX > minX ? maxX : minX + 1;
+    m_absMinY = minY;
+    m_absMaxY = maxY > minY ? maxY : minY + 1;
+}
+
+bool EvdevSource::IsPointer(int fd) {
+    unsigned long rel[NLONGS(REL_CNT)] = {0};
+    unsigned long abs[NLONGS(ABS_CNT)] = {0};
+    ioctl(fd, EVIOCGBIT(EV_REL, sizeof(rel)), rel);
+    ioctl(fd, EVIOCGBIT(EV_ABS, sizeof(abs)), abs);
+    return (TEST_BIT(REL_X, rel) && TEST_BIT(REL_Y, rel)) ||
+           (TEST_BIT(ABS_X, abs) && TEST_BIT(ABS_Y, abs));
+}
+
+bool EvdevSource::Open(const char* path) {
+    Close();
+
+    struct stat st;
+    if (stat(path, &st) < 0) return false;
+    m_recording = !S_ISCHR(st.st_mode);
+
+    m_fd = open(path, O_RDONLY | O_CLOEXEC | (m_recording ? 0 : O_NONBLOCK));
+    if (m_fd < 0) return false;
+
+    snprintf(m_name, sizeof(m_name), "%s", path);
+    if (m_recording) return true;
+
+    // Kernel timestamps on the same clock as the rest of the pipeline
+    int clk = CLOCK_MONOTONIC;
+    ioctl(m_fd, EVIOCSCLOCKID, &clk);
+    ioctl(m_fd, EVIOCGNAME(sizeof(m_name)), m_name);
+
+    struct input_absinfo ax, ay;
+    if (ioctl(m_fd, EVIOCGABS(ABS_X), &ax) == 0 && ioctl(m_fd, EVIOCGABS(ABS_Y), &ay) == 0) {
+        SetAbsRange(ax.minimum, ax.maximum, ay.minimum, ay.maximum);
+    }
+    return true;
+}
+
+bool EvdevSource::OpenFirstPointer() {
+    char path[64];
+    for (int i = 0; i < 64; ++i) {
+        snprintf(path, sizeof(path), "/dev/input/event%d", i);
+        int fd = open(path, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+        if (fd < 0) continue;
+        bool pointer = IsPointer(fd);
+        close(fd);
+        if (pointer && Open(path)) return true;
+    }
+    return false;
+}
+
+void EvdevSource::Close() {
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_moved = false;
+}
+
+bool EvdevSource::Read(std::vector<TrailSample>& out) {
+    if (m_fd < 0) return false;
+
+    struct input_event events[64];
+    for (;;) {
+        ssize_t len = read(m_fd, events, sizeof(events));
+        if (len < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (len == 0) return false; // End of recording
+
+        size_t n = (size_t)len / sizeof(struct input_event);
+        for (size_t i = 0; i < n; ++i) HandleEvent(events[i], out);
+
+        // Recordings: hand back one chunk at a time so the caller can log as it goes
+        if (m_recording) return true;
+    }
+}
+
+void EvdevSource::HandleEvent(const struct input_event& ev, std::vector<TrailSample>& out) {
+    m_events++;
+
+    if (ev.type == EV_REL) {
+        if (ev.code == REL_X) { m_x += ev.value; m_moved = true; }
+        else if (ev.code == REL_Y) { m_y += ev.value; m_moved = true; }
+    } else if (ev.type == EV_ABS) {
+        if (ev.code == ABS_X) {
+            m_x = (double)(ev.value - m_absMinX) * (m_screenW - 1) / (m_absMaxX - m_absMinX);
+            m_moved = true;
+        } else if (ev.code == ABS_Y) {
+            m_y = (double)(ev.value - m_absMinY) * (m_screenH - 1) / (m_absMaxY - m_absMinY);
+            m_moved = true;
+        }
+    } else if (ev.type == EV_SYN && ev.code == SYN_REPORT && m_moved) {
+        m_moved = false;
+
+        if (m_x < 0) m_x = 0;
+        if (m_y < 0) m_y = 0;
+        if (m_x > m_screenW - 1) m_x = m_screenW - 1;
+        if (m_y > m_screenH - 1) m_y = m_screenH - 1;
+
+        // Sub-pixel motion accumulates without producing duplicate samples
+        TrailSample s;
+        s.x = (int)m_x;
+        s.y = (int)m_y;
+        if (s.x == m_lastX && s.y == m_lastY) return;
+        m_lastX = s.x;
+        m_lastY = s.y;
+
+        s.t = (long long)ev.input_event_sec * 1000000000LL + (long long)ev.input_event_usec * 1000LL;
+        out.push_back(s);
+    }
+}
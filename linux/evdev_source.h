@@ -0,0 +1,70 @@
+/*
+    evdev Cursor Source
+    Reads pointer events straight from /dev/input/event* (no X server or
+    compositor needed) and integrates them into screen coordinates.
+
+    - Relative devices (mice, trackpads in relative mode): REL_X / REL_Y
+      deltas are accumulated and clamped to the screen.
+    - Absolute devices (touchscreens, tablets, VM pointers): ABS_X / ABS_Y
+      are scaled from the device range to the screen.
+
+    A recording is a raw dump of struct input_event records, e.g.
+    `cat /dev/input/event3 > session.evdev`. It is read in file order with its own
+    timestamps, so a recording always produces the same trail.
+*/
+
+#ifndef EVDEV_SOURCE_H
+#define EVDEV_SOURCE_H
+
+#include <vector>
+#include <linux/input.h>
+#include "trail_sample.h"
+
+class EvdevSource {
+public:
+    EvdevSource();
+    ~EvdevSource();
+
+    void SetScreen(int w, int h);
+    void SetPosition(int x, int y);     // Start point for relative devices
+    // Device range for ABS_X/ABS_Y. Read from the device when opening one,
+    // must be given for recordings of absolute devices (default 0..32767).
+    void SetAbsRange(int minX, int maxX, int minY, int maxY);
+
+    // Character device or recording file (detected automatically)
+    bool Open(const char* path);
+    // First /dev/input/event* that reports pointer motion
+    bool OpenFirstPointer();
+    void Close();
+
+    int GetFd() const { return m_fd; }
+    bool IsRecording() const { return m_recording; }
+    const char* GetName() const { return m_name; }
+
+    // Reads what is available (devices: non-blocking; recordings: one chunk)
+    // and appends one sample per SYN_REPORT that moved the cursor.
+    // Returns false on end of recording / device error.
+    bool Read(std::vector<TrailSample>& out);
+
+    // Stats
+    unsigned long long GetEventCount() const { return m_events; }
+
+private:
+    static bool IsPointer(int fd);
+    void HandleEvent(const struct input_event& ev, std::vector<TrailSample>& out);
+
+    int m_fd;
+    bool m_recording;
+    char m_name[128];
+
+    int m_screenW, m_screenH;
+    double m_x, m_y;
+    int m_lastX, m_lastY;
+
+    int m_absMinX, m_absMaxX, m_absMinY, m_absMaxY;
+    bool m_moved;
+
+    unsigned long long m_events;
+};
+
+#endif
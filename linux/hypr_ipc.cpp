@@ -0,0 +1,192 @@
+#include "hypr_ipc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Don't hammer a compositor that is gone / restarting
+static const long long RECONNECT_BACKOFF_MS = 500;
+// Don't let a stuck compositor freeze the UI thread
+static const int REPLY_TIMEOUT_MS = 100;
+
+static long long NowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool DirExists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+HyprIpc::HyprIpc() : m_sock(-1), m_eventSock(-1), m_lastFailMs(0), m_connects(0), m_failures(0) {}
+
+HyprIpc::~HyprIpc() {
+    Close();
+    CloseEvents();
+}
+
+bool HyprIpc::Init() {
+    const char* over = getenv("MOUSE_TRACKER_HYPR_DIR");
+    if (over && *over) {
+        m_dir = over;
+        return true;
+    }
+
+    const char* sig = getenv("HYPRLAND_INSTANCE_SIGNATURE");
+    if (!sig) return false; // Not running Hyprland?
+
+    const char* runtime = getenv("XDG_RUNTIME_DIR");
+    if (runtime) {
+        std::string dir = std::string(runtime) + "/hypr/" + sig;
+        if (DirExists(dir)) {
+            m_dir = dir;
+            return true;
+        }
+    }
+    m_dir = std::string("/tmp/hypr/") + sig;
+    return true;
+}
+
+int HyprIpc::Connect(const char* name) {
+    if (m_dir.empty()) return -1;
+
+    std::string path = m_dir + "/" + name;
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -1;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path)-1);
+
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    m_connects++;
+    return sock;
+}
+
+bool HyprIpc::EnsureConnected() {
+    if (m_sock >= 0) return true;
+
+    long long now = NowMs();
+    if (m_lastFailMs && now - m_lastFailMs < RECONNECT_BACKOFF_MS) return false;
+
+    m_sock = Connect(".socket.sock");
+    if (m_sock < 0) {
+        m_failures++;
+        m_lastFailMs = now;
+        return false;
+    }
+    m_lastFailMs = 0;
+    return true;
+}
+
+bool HyprIpc::Request(const char* cmd, std::string& reply) {
+    size_t cmdLen = strlen(cmd);
+
+    // Second attempt covers a reused connection the server had already closed
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool reused = (m_sock >= 0);
+        if (!EnsureConnected()) return false;
+
+        if (send(m_sock, cmd, cmdLen, MSG_NOSIGNAL) != (ssize_t)cmdLen) {
+            Close();
+            if (reused) continue;
+            m_failures++;
+            return false;
+        }
+
+        struct pollfd pfd = { m_sock, POLLIN, 0 };
+        if (poll(&pfd, 1, REPLY_TIMEOUT_MS) <= 0) {
+            Close();
+            m_failures++;
+            return false;
+        }
+
+        char buffer[512];
+        ssize_t len = recv(m_sock, buffer, sizeof(buffer), 0);
+        if (len <= 0) {
+            Close();
+            if (reused) continue;
+            m_failures++;
+            return false;
+        }
+        reply.assign(buffer, len);
+
+        // Hyprland closes after every reply; notice now rather than on the next send
+        char peek;
+        if (recv(m_sock, &peek, 1, MSG_PEEK | MSG_DONTWAIT) == 0) Close();
+        return true;
+    }
+    return false;
+}
+
+bool HyprIpc::GetCursor(int& x, int& y) {
+    std::string reply;
+    if (!Request("cursorpos", reply)) return false;
+    // Format is "123, 456"
+    return sscanf(reply.c_str(), "%d, %d", &x, &y) == 2;
+}
+
+void HyprIpc::Close() {
+    if (m_sock >= 0) {
+        close(m_sock);
+        m_sock = -1;
+    }
+}
+
+bool HyprIpc::OpenEvents() {
+    if (m_eventSock >= 0) return true;
+    m_eventSock = Connect(".socket2.sock");
+    if (m_eventSock < 0) return false;
+
+    fcntl(m_eventSock, F_SETFL, fcntl(m_eventSock, F_GETFL) | O_NONBLOCK);
+    m_eventBuf.clear();
+    return true;
+}
+
+bool HyprIpc::ReadEvents(std::vector<std::string>& lines) {
+    if (m_eventSock < 0) return false;
+
+    char buffer[4096];
+    for (;;) {
+        ssize_t len = read(m_eventSock, buffer, sizeof(buffer));
+        if (len > 0) {
+            m_eventBuf.append(buffer, len);
+            continue;
+        }
+        if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (len < 0 && errno == EINTR) continue;
+        // EOF or hard error: compositor went away
+        CloseEvents();
+        return false;
+    }
+
+    size_t start = 0, nl;
+    while ((nl = m_eventBuf.find('\n', start)) != std::string::npos) {
+        lines.push_back(m_eventBuf.substr(start, nl - start));
+        start = nl + 1;
+    }
+    m_eventBuf.erase(0, start);
+    return true;
+}
+
+void HyprIpc::CloseEvents() {
+    if (m_eventSock >= 0) {
+        close(m_eventSock);
+        m_eventSock = -1;
+    }
+    m_eventBuf.clear();
+}
@@ -0,0 +1,62 @@
+/*
+    Hyprland IPC Client
+    Keeps the event stream (.socket2.sock) open across ticks. The request
+    socket (.socket.sock) is reused only while the server leaves it open;
+    stock Hyprland closes it after every reply, so real sessions still
+    connect once per sample (50 a second at the default 20 ms interval).
+
+    Socket directory lookup order:
+      $MOUSE_TRACKER_HYPR_DIR               (stand-in server for testing)
+      $XDG_RUNTIME_DIR/hypr/<signature>     (Hyprland >= 0.40)
+      /tmp/hypr/<signature>                 (older Hyprland)
+*/
+
+#ifndef HYPR_IPC_H
+#define HYPR_IPC_H
+
+#include <string>
+#include <vector>
+
+class HyprIpc {
+public:
+    HyprIpc();
+    ~HyprIpc();
+
+    // Resolves the socket directory. Returns false if none could be found.
+    bool Init();
+    const std::string& GetSocketDir() const { return m_dir; }
+
+    // Sends one command on the request socket and reads the reply.
+    // The connection is reused while the server keeps it open and is
+    // re-established (once per call, rate limited) when it is not.
+    bool Request(const char* cmd, std::string& reply);
+    bool GetCursor(int& x, int& y);
+
+    // Event stream. ReadEvents() is non-blocking and returns whole
+    // "EVENT>>DATA" lines; it returns false once the stream has closed.
+    bool OpenEvents();
+    bool ReadEvents(std::vector<std::string>& lines);
+    void CloseEvents();
+    int GetEventFd() const { return m_eventSock; }
+
+    void Close();
+
+    // Stats
+    int GetConnectCount() const { return m_connects; }
+    int GetFailureCount() const { return m_failures; }
+
+private:
+    int Connect(const char* name);
+    bool EnsureConnected();
+
+    std::string m_dir;
+    int m_sock;
+    int m_eventSock;
+    std::string m_eventBuf;
+
+    long long m_lastFailMs;
+    int m_connects;
+    int m_failures;
+};
+
+#endif
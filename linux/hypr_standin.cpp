@@ -0,0 +1,352 @@
+/*
+ * Hyprland IPC stand-in
+ *
+ * Serves the two Hyprland sockets from a directory of its own, so the
+ * tracker and HyprIpc can be run without Hyprland:
+ *   .socket.sock    answers "cursorpos" with "X, Y" (a cursor moving in a
+ *                   circle) and, like Hyprland, closes the connection after
+ *                   every reply
+ *   .socket2.sock   sends "activewindow>>" / "workspace>>" events
+ *
+ * Usage:
+ *   ./hypr_standin --serve [dir] [--keep-open]
+ *       Serves until Ctrl+C (default dir: /tmp/hypr_standin). Then run
+ *       MOUSE_TRACKER_HYPR_DIR=<dir> ./mouse_tracker_hyprland
+ *       --keep-open answers any number of requests per connection.
+ *   ./hypr_standin --selftest
+ *       Runs HyprIpc against the stand-in: a connection per request,
+ *       connection reuse, the reconnect backoff across a restart, and the
+ *       event stream closing and reopening. Exits 0 if all of it works.
+ *
+ * Compile:
+ * g++ -O2 -o hypr_standin hypr_standin.cpp hypr_ipc.cpp -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "hypr_ipc.h"
+
+volatile sig_atomic_t g_running = 1;
+
+class StandIn {
+public:
+    StandIn() : m_requestListen(-1), m_eventListen(-1), m_keepOpen(false), m_run(false),
+                m_replies(0), m_pendingEvents(0), m_eventClients(0) {}
+    ~StandIn() { Stop(); }
+
+    bool Start(const std::string& dir, bool keepOpen);
+    // Closes the sockets and every connection, as a compositor exit would
+    void Stop();
+
+    // Sends n events to every event stream client
+    void SendEvents(int n) { m_pendingEvents += n; }
+    int GetEventClients() const { return m_eventClients; }
+    int GetReplies() const { return m_replies; }
+
+    // Where the cursor is after n replies
+    static void CursorAt(int n, int& x, int& y);
+
+private:
+    int Listen(const char* name);
+    void Loop();
+    void Answer(int fd, bool& closeIt);
+
+    std::string m_dir;
+    int m_requestListen, m_eventListen;
+    bool m_keepOpen;
+    std::vector<int> m_requests, m_events;
+    std::thread m_thread;
+    std::atomic<bool> m_run;
+    std::atomic<int> m_replies;
+    std::atomic<int> m_pendingEvents;
+    std::atomic<int> m_eventClients;
+};
+
+void StandIn::CursorAt(int n, int& x, int& y) {
+    x = 960 + (int)(400 * cos(n * 0.05));
+    y = 540 + (int)(300 * sin(n * 0.05));
+}
+
+int StandIn::Listen(const char* name) {
+    std::string path = m_dir + "/" + name;
+    unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 16) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+bool StandIn::Start(const std::string& dir, bool keepOpen) {
+    Stop();
+    m_dir = dir;
+    m_keepOpen = keepOpen;
+    mkdir(m_dir.c_str(), 0700);
+    m_requestListen = Listen(".socket.sock");
+    m_eventListen = Listen(".socket2.sock");
+    if (m_requestListen < 0 || m_eventListen < 0) {
+        Stop();
+        return false;
+    }
+    m_run = true;
+    m_thread = std::thread(&StandIn::Loop, this);
+    return true;
+}
+
+void StandIn::Stop() {
+    m_run = false;
+    if (m_thread.joinable()) m_thread.join();
+
+    for (size_t i = 0; i < m_requests.size(); ++i) close(m_requests[i]);
+    for (size_t i = 0; i < m_events.size(); ++i) close(m_events[i]);
+    m_requests.clear();
+    m_events.clear();
+    m_eventClients = 0;
+    if (m_requestListen >= 0) close(m_requestListen);
+    if (m_eventListen >= 0) close(m_eventListen);
+    m_requestListen = m_eventListen = -1;
+    if (!m_dir.empty()) {
+        unlink((m_dir + "/.socket.sock").c_str());
+        unlink((m_dir + "/.socket2.sock").c_str());
+    }
+}
+
+void StandIn::Answer(int fd, bool& closeIt) {
+    char cmd[256];
+    ssize_t len = recv(fd, cmd, sizeof(cmd) - 1, 0);
+    if (len <= 0) {
+        closeIt = true;
+        return;
+    }
+    cmd[len] = 0;
+
+    char reply[64];
+    if (strcmp(cmd, "cursorpos") == 0) {
+        int x, y;
+        CursorAt(m_replies, x, y);
+        snprintf(reply, sizeof(reply), "%d, %d", x, y);
+    } else {
+        snprintf(reply, sizeof(reply), "unknown request");
+    }
+    send(fd, reply, strlen(reply), MSG_NOSIGNAL);
+    m_replies++;
+    closeIt = !m_keepOpen;
+}
+
+void StandIn::Loop() {
+    int eventNumber = 0;
+    while (m_run) {
+        std::vector<struct pollfd> fds;
+        struct pollfd listenFds[2] = { { m_requestListen, POLLIN, 0 }, { m_eventListen, POLLIN, 0 } };
+        fds.assign(listenFds, listenFds + 2);
+        for (size_t i = 0; i < m_requests.size(); ++i) {
+            struct pollfd p = { m_requests[i], POLLIN, 0 };
+            fds.push_back(p);
+        }
+        if (poll(&fds[0], fds.size(), 10) < 0 && errno != EINTR) break;
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(m_requestListen, NULL, NULL);
+            if (fd >= 0) m_requests.push_back(fd);
+        }
+        if (fds[1].revents & POLLIN) {
+            int fd = accept(m_eventListen, NULL, NULL);
+            if (fd >= 0) m_events.push_back(fd);
+            m_eventClients = (int)m_events.size();
+        }
+
+        // Requests, back to front so closed ones can be erased
+        for (size_t i = fds.size(); i-- > 2;) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP))) continue;
+            bool closeIt = false;
+            Answer(fds[i].fd, closeIt);
+            if (closeIt) {
+                close(fds[i].fd);
+                m_requests.erase(m_requests.begin() + (i - 2));
+            }
+        }
+
+        for (; m_pendingEvents > 0; m_pendingEvents--) {
+            eventNumber++;
+            char line[128];
+            if (eventNumber % 2) snprintf(line, sizeof(line), "activewindow>>standin,Window %d\n", eventNumber);
+            else snprintf(line, sizeof(line), "workspace>>%d\n", eventNumber % 10);
+            for (size_t i = m_events.size(); i-- > 0;) {
+                if (send(m_events[i], line, strlen(line), MSG_NOSIGNAL) < 0) {
+                    close(m_events[i]);
+                    m_events.erase(m_events.begin() + i);
+                }
+            }
+            m_eventClients = (int)m_events.size();
+        }
+    }
+}
+
+// Selftest
+
+int g_failed = 0;
+
+void Check(bool ok, const char* what) {
+    printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) g_failed++;
+}
+
+void Sleep(int ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+// Polls the event stream for up to ms; false once it has closed
+bool WaitEvents(HyprIpc& ipc, std::vector<std::string>& lines, size_t want, int ms) {
+    for (int waited = 0; waited < ms && lines.size() < want; waited += 10) {
+        struct pollfd p = { ipc.GetEventFd(), POLLIN, 0 };
+        poll(&p, 1, 10);
+        if (!ipc.ReadEvents(lines)) return false;
+    }
+    return true;
+}
+
+int SelfTest() {
+    char dir[] = "/tmp/hypr_standin.XXXXXX";
+    if (!mkdtemp(dir)) {
+        printf("can't create a socket directory\n");
+        return 1;
+    }
+    setenv("MOUSE_TRACKER_HYPR_DIR", dir, 1);
+
+    StandIn server;
+    const int REQUESTS = 200;
+
+    // Hyprland closes after every reply: each request needs a new connection
+    {
+        Check(server.Start(dir, false), "stand-in listening");
+        HyprIpc ipc;
+        ipc.Init();
+        int good = 0;
+        for (int i = 0; i < REQUESTS; ++i) {
+            int x, y, wantX, wantY;
+            StandIn::CursorAt(i, wantX, wantY);
+            if (ipc.GetCursor(x, y) && x == wantX && y == wantY) good++;
+        }
+        Check(good == REQUESTS, "every cursorpos answered, closing after each reply");
+        Check(ipc.GetConnectCount() == REQUESTS, "one connection per request");
+        Check(ipc.GetFailureCount() == 0, "no failures");
+        server.Stop();
+    }
+
+    // A server that keeps the connection open gets it reused
+    {
+        server.Start(dir, true);
+        HyprIpc ipc;
+        ipc.Init();
+        int good = 0;
+        for (int i = 0; i < REQUESTS; ++i) {
+            int x, y;
+            if (ipc.GetCursor(x, y)) good++;
+        }
+        Check(good == REQUESTS, "every cursorpos answered on a kept-open connection");
+        Check(ipc.GetConnectCount() == 1, "the connection is reused");
+        server.Stop();
+    }
+
+    // Compositor restart: fail fast during the backoff, then reconnect
+    {
+        server.Start(dir, false);
+        HyprIpc ipc;
+        ipc.Init();
+        int x, y;
+        Check(ipc.GetCursor(x, y), "request before the restart");
+        server.Stop();
+        Check(!ipc.GetCursor(x, y), "request while the server is gone fails");
+        int connects = ipc.GetConnectCount();
+        int failures = ipc.GetFailureCount();
+        server.Start(dir, false);
+        Check(!ipc.GetCursor(x, y) && ipc.GetConnectCount() == connects, "no reconnect inside the backoff");
+        Check(ipc.GetFailureCount() == failures, "backed-off calls aren't counted as failures");
+        Sleep(600);
+        Check(ipc.GetCursor(x, y), "reconnects once the backoff is over");
+        server.Stop();
+    }
+
+    // Event stream: lines arrive whole, a restart closes the stream, it reopens
+    {
+        server.Start(dir, false);
+        HyprIpc ipc;
+        ipc.Init();
+        Check(ipc.OpenEvents(), "event stream opens");
+        for (int waited = 0; server.GetEventClients() == 0 && waited < 1000; waited += 10) Sleep(10);
+        server.SendEvents(5);
+        std::vector<std::string> lines;
+        WaitEvents(ipc, lines, 5, 1000);
+        Check(lines.size() == 5 && lines[0].compare(0, 14, "activewindow>>") == 0 &&
+              lines[1].compare(0, 11, "workspace>>") == 0, "five events, whole lines");
+
+        server.Stop();
+        lines.clear();
+        Check(!WaitEvents(ipc, lines, 1, 1000) && ipc.GetEventFd() < 0, "stream closes with the server");
+        server.Start(dir, false);
+        Check(ipc.OpenEvents(), "event stream reopens after the restart");
+        server.Stop();
+    }
+
+    rmdir(dir);
+    printf(g_failed ? "%d check(s) failed\n" : "all checks passed\n", g_failed);
+    return g_failed ? 1 : 0;
+}
+
+void Interrupt(int) {
+    g_running = 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1 && strcmp(argv[1], "--selftest") == 0) return SelfTest();
+
+    if (argc < 2 || strcmp(argv[1], "--serve") != 0) {
+        printf("Usage: hypr_standin --serve [dir] [--keep-open] | --selftest\n");
+        return 1;
+    }
+    std::string dir = "/tmp/hypr_standin";
+    bool keepOpen = false;
+    for (int i = 2; i < argc; ++i) {
+        if (strcmp(argv[i], "--keep-open") == 0) keepOpen = true;
+        else dir = argv[i];
+    }
+
+    StandIn server;
+    if (!server.Start(dir, keepOpen)) {
+        printf("Can't listen in %s\n", dir.c_str());
+        return 1;
+    }
+    signal(SIGINT, Interrupt);
+    signal(SIGTERM, Interrupt);
+    printf("Serving %s, run: MOUSE_TRACKER_HYPR_DIR=%s ./mouse_tracker_hyprland\n", dir.c_str(), dir.c_str());
+
+    // An event now and then, so the tracker's focus sampling has something to react to
+    while (g_running) {
+        usleep(500 * 1000);
+        server.SendEvents(1);
+    }
+    server.Stop();
+    return 0;
+}
@@ -0,0 +1,296 @@
+/*
+ * Mouse Tracker for headless / kiosk Linux (evdev)
+ *
+ * Reads pointer events straight from /dev/input, so it works without an
+ * X server or compositor. No UI: logs to mouse_log.txt (mouse_log.bin with
+ * LogFormat=binary or columnar) until Ctrl+C.
+ *
+ * Usage:
+ *   ./mouse_tracker_evdev                       (first pointer device found)
+ *   ./mouse_tracker_evdev --device /dev/input/event3
+ *   ./mouse_tracker_evdev --replay session.evdev (recorded event stream)
+ *
+ * Options:
+ *   --screen WxH                 Screen size (default: settings.ini, then
+ *                                the first connected DRM output, then 1920x1080)
+ *   --abs-range x0,x1,y0,y1      ABS_X/ABS_Y range for absolute recordings
+ *
+ * Needs read access to /dev/input/event* (root or the "input" group).
+ *
+ * Compile:
+ * g++ -O2 -o mouse_tracker_evdev main_evdev.cpp evdev_source.cpp ../common/trail_log.cpp ../common/trail_ring.cpp ../common/trail_segments.cpp ../common/trail_columns.cpp ../common/mapped_file.cpp ../common/uring_file.cpp -I../common
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <poll.h>
+#include <glob.h>
+#include <vector>
+
+#include "evdev_source.h"
+#include "trail_clock.h"
+#include "trail_log.h"
+#include "trail_ring.h"
+#include "trail_segments.h"
+#include "uring_file.h"
+
+// Globals
+volatile sig_atomic_t g_running = 1;
+TrailWriter logWriter;
+TrailRing logRing; // AutoClear=2
+TrailSegmentWriter logSegments; // SegmentMB / SegmentMinutes
+
+// Settings
+int g_autoClear = 1;      // 1 = truncate, 0 = append, 2 = ring file
+int g_ringFileMB = 64;
+int g_segmentMB = 0, g_segmentMinutes = 0; // either > 0 = segmented log
+int g_indexEvery = 1000;  // samples per .idx entry, 0 = no index
+int g_screenW = 0, g_screenH = 0;
+TrailFormat g_logFormat = TRAIL_FORMAT_TEXT;
+bool g_logUring = false;  // LogBackend=uring
+bool g_logDirect = false; // LogDirect=1, with io_uring only
+
+const char* LOG_FILENAME = "mouse_log.txt";
+const char* LOG_FILENAME_BINARY = "mouse_log.bin";
+const char* LOG_FILENAME_RING = "mouse_log.ring";
+const char* LOG_SEGMENT_BASE = "mouse_log"; // + .manifest / .000001.txt
+const char* SETTINGS_FILENAME = "settings.ini";
+
+// Helper to read INI (simplified for Linux)
+int GetIniInt(const char* section, const char* key, int defVal) {
+    FILE* f = fopen(SETTINGS_FILENAME, "r");
+    if (!f) return defVal;
+
+    char line[256];
+    char currentSection[64] = "";
+    int val = defVal;
+    bool inSection = false;
+
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\n")] = 0;
+        if (line[0] == '[') {
+            sscanf(line, "[%[^]]", currentSection);
+            inSection = (strcmp(currentSection, section) == 0);
+        } else if (inSection) {
+            char k[64], v[64];
+            if (sscanf(line, "%[^=]=%s", k, v) == 2) {
+                if (strcmp(k, key) == 0) {
+                    val = atoi(v);
+                    break;
+                }
+            }
+        }
+    }
+    fclose(f);
+    return val;
+}
+
+void GetIniString(const char* section, const char* key, const char* defVal, char* out, size_t outSize) {
+    snprintf(out, outSize, "%s", defVal);
+    FILE* f = fopen(SETTINGS_FILENAME, "r");
+    if (!f) return;
+
+    char line[256];
+    char currentSection[64] = "";
+    bool inSection = false;
+
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '[') {
+            sscanf(line, "[%[^]]", currentSection);
+            inSection = (strcmp(currentSection, section) == 0);
+        } else if (inSection) {
+            char k[64], v[192];
+            if (sscanf(line, "%[^=]=%191s", k, v) == 2 && strcmp(k, key) == 0) {
+                snprintf(out, outSize, "%s", v);
+                break;
+            }
+        }
+    }
+    fclose(f);
+}
+
+void LoadSettings() {
+    g_autoClear = GetIniInt("Settings", "AutoClear", 1);
+    g_ringFileMB = GetIniInt("Settings", "RingFileMB", 64);
+    if (g_ringFileMB < 1) g_ringFileMB = 1;
+    if (g_ringFileMB > 2000) g_ringFileMB = 2000;
+    g_segmentMB = GetIniInt("Settings", "SegmentMB", 0);
+    g_segmentMinutes = GetIniInt("Settings", "SegmentMinutes", 0);
+    logSegments.SetSegmentLimits(g_segmentMB, g_segmentMinutes, GetIniInt("Settings", "SegmentKeep", 0));
+    g_screenW = GetIniInt("Settings", "ScreenWidth", 0);
+    g_screenH = GetIniInt("Settings", "ScreenHeight", 0);
+    char format[16];
+    GetIniString("Settings", "LogFormat", "text", format, sizeof(format));
+    g_logFormat = ParseTrailFormat(format);
+    char backend[16];
+    GetIniString("Settings", "LogBackend", "stdio", backend, sizeof(backend));
+    g_logUring = strcmp(backend, "uring") == 0;
+    g_logDirect = GetIniInt("Settings", "LogDirect", 0) == 1;
+
+    char durability[16];
+    GetIniString("Settings", "Durability", "none", durability, sizeof(durability));
+    logWriter.SetCommitPolicy(GetIniInt("Settings", "CommitSamples", 1000),
+                              GetIniInt("Settings", "CommitMs", 1000),
+                              ParseTrailDurability(durability));
+    g_indexEvery = GetIniInt("Settings", "IndexEvery", 1000);
+    logSegments.SetIndexEvery(g_indexEvery);
+    logSegments.SetCommitPolicy(GetIniInt("Settings", "CommitSamples", 1000),
+                                GetIniInt("Settings", "CommitMs", 1000),
+                                ParseTrailDurability(durability));
+    logRing.SetCommitPolicy(GetIniInt("Settings", "CommitMs", 1000), ParseTrailDurability(durability));
+}
+
+// LogBackend=uring submits through io_uring (and falls back to write() by itself)
+FILE* OpenLogFile(const char* path, const char* mode) {
+    if (g_logUring) return OpenUringFile(path, mode, g_logDirect);
+    return fopen(path, mode);
+}
+
+// No display server to ask, so take the preferred mode of the first connected output
+bool DetectScreenSize(int& w, int& h) {
+    glob_t g;
+    if (glob("/sys/class/drm/card*-*/status", 0, NULL, &g) != 0) return false;
+
+    bool found = false;
+    for (size_t i = 0; i < g.gl_pathc && !found; ++i) {
+        char status[32] = "";
+        FILE* f = fopen(g.gl_pathv[i], "r");
+        if (!f) continue;
+        if (!fgets(status, sizeof(status), f)) status[0] = 0;
+        fclose(f);
+        if (strncmp(status, "connected", 9) != 0) continue;
+
+        char modes[512];
+        snprintf(modes, sizeof(modes), "%s", g.gl_pathv[i]);
+        strcpy(strrchr(modes, '/'), "/modes");
+        f = fopen(modes, "r");
+        if (!f) continue;
+        found = fscanf(f, "%dx%d", &w, &h) == 2;
+        fclose(f);
+    }
+    globfree(&g);
+    return found;
+}
+
+void OnSignal(int) {
+    g_running = 0;
+}
+
+int main(int argc, char** argv) {
+    const char* device = NULL;
+    const char* replay = NULL;
+    int absRange[4];
+    bool haveAbsRange = false;
+
+    LoadSettings();
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) device = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replay = argv[++i];
+        else if (strcmp(argv[i], "--screen") == 0 && i + 1 < argc) sscanf(argv[++i], "%dx%d", &g_screenW, &g_screenH);
+        else if (strcmp(argv[i], "--abs-range") == 0 && i + 1 < argc) {
+            haveAbsRange = sscanf(argv[++i], "%d,%d,%d,%d", &absRange[0], &absRange[1], &absRange[2], &absRange[3]) == 4;
+        } else {
+            fprintf(stderr, "Usage: %s [--device PATH | --replay FILE] [--screen WxH] [--abs-range x0,x1,y0,y1]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (g_screenW <= 0 || g_screenH <= 0) {
+        if (!DetectScreenSize(g_screenW, g_screenH)) {
+            g_screenW = 1920;
+            g_screenH = 1080;
+        }
+    }
+
+    EvdevSource source;
+    source.SetScreen(g_screenW, g_screenH);
+    if (haveAbsRange) source.SetAbsRange(absRange[0], absRange[1], absRange[2], absRange[3]);
+
+    bool opened;
+    if (replay) opened = source.Open(replay);
+    else if (device) opened = source.Open(device);
+    else opened = source.OpenFirstPointer();
+
+    if (!opened) {
+        fprintf(stderr, "No pointer device could be opened (need access to /dev/input/event*)\n");
+        return 1;
+    }
+
+    // Event driven, no fixed interval
+    bool useRing = g_autoClear == 2;
+    bool useSegments = !useRing && (g_segmentMB > 0 || g_segmentMinutes > 0);
+    const char* logName = useRing ? LOG_FILENAME_RING :
+                          g_logFormat != TRAIL_FORMAT_TEXT ? LOG_FILENAME_BINARY : LOG_FILENAME;
+    if (useRing) {
+        if (!logRing.Open(logName, (size_t)g_ringFileMB << 20, 0, g_screenW, g_screenH)) {
+            fprintf(stderr, "Failed to map %s\n", logName);
+            return 1;
+        }
+    } else if (useSegments) {
+        logSegments.SetFileOpener(OpenLogFile);
+        if (!logSegments.Open(LOG_SEGMENT_BASE, g_autoClear == 0, 0, g_logFormat, g_screenW, g_screenH)) {
+            fprintf(stderr, "Failed to open the first segment of %s\n", LOG_SEGMENT_BASE);
+            return 1;
+        }
+    } else {
+        FILE* f = OpenLogFile(logName, g_autoClear ? "wb" : "ab");
+        if (!f) {
+            fprintf(stderr, "Failed to open %s\n", logName);
+            return 1;
+        }
+        logWriter.Open(f, 0, g_logFormat, g_screenW, g_screenH);
+        if (g_indexEvery > 0) {
+            logWriter.OpenIndex(fopen((std::string(logName) + ".idx").c_str(), g_autoClear ? "wb" : "ab"), g_indexEvery);
+        }
+    }
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    printf("Tracking %s on a %dx%d screen. Ctrl+C to stop.\n", source.GetName(), g_screenW, g_screenH);
+
+    std::vector<TrailSample> batch;
+    long long startNs = GetMonotonicNs();
+    unsigned long long samples = 0;
+
+    while (g_running) {
+        if (!source.IsRecording()) {
+            struct pollfd pfd = { source.GetFd(), POLLIN, 0 };
+            if (poll(&pfd, 1, -1) < 0) continue; // EINTR from Ctrl+C
+        }
+
+        batch.clear();
+        bool more = source.Read(batch);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (useRing) logRing.Append(batch[i]);
+            else if (useSegments) logSegments.Append(batch[i]);
+            else logWriter.Append(batch[i]);
+        }
+        samples += batch.size();
+        if (!batch.empty() && !source.IsRecording()) {
+            if (useRing) logRing.Flush();
+            else if (useSegments) logSegments.Flush();
+            else logWriter.Flush();
+        }
+
+        if (!more) break;
+    }
+
+    logWriter.Close();
+    logRing.Close();
+    logSegments.Close();
+
+    unsigned long long records = useRing ? logRing.GetRecordCount() :
+                                 useSegments ? logSegments.GetRecordCount() : logWriter.GetRecordCount();
+    unsigned long long commits = useSegments ? logSegments.GetCommitCount() : logWriter.GetCommitCount();
+    double secs = (GetMonotonicNs() - startNs) / 1e9;
+    printf("%llu events -> %llu samples (%llu records, %llu commits) in %.3fs", source.GetEventCount(),
+           samples, records, commits, secs);
+    if (source.IsRecording() && secs > 0) printf(", %.0f events/s", source.GetEventCount() / secs);
+    printf("\n");
+    return 0;
+}
@@ -6,12 +6,22 @@
  * - GTK3 (UI & Main Loop)
  * - GtkLayerShell (For transparent overlay on Wayland)
  * - Hyprland IPC (For fast cursor tracking without polling heavy commands)
+ *   The request socket is reused while the server keeps it open (stock
+ *   Hyprland doesn't, so that is still a connect per sample; see
+ *   hypr_ipc.h) and the .socket2.sock event stream triggers an immediate
+ *   sample on focus / workspace / monitor changes.
+ * - A capture thread samples on its own schedule and feeds a lock-free ring
+ *   that the GTK side drains, so slow frames or disk stalls don't skew Interval.
+ * - CursorSource=replay / synthetic in settings.ini replaces the compositor as
+ *   the source of positions (load testing without Hyprland).
+ * - --output - (or --output <fifo>) streams the samples to stdout or a FIFO
+ *   instead of the log (see common/trail_stream.h).
  * 
  * Dependencies (Arch):
  * sudo pacman -S gtk3 gtk-layer-shell gcc pkgconf
  * 
  * Compile:
- * g++ -o mouse_tracker_hyprland main_hyprland.cpp $(pkg-config --cflags --libs gtk+-3.0 gtk-layer-shell-0)
+ * g++ -o mouse_tracker_hyprland main_hyprland.cpp hypr_ipc.cpp ../common/trail_log.cpp ../common/async_logger.cpp ../common/trail_ring.cpp ../common/trail_segments.cpp ../common/trail_columns.cpp ../common/trail_store.cpp ../common/trail_view.cpp ../common/trail_stream.cpp ../common/mapped_file.cpp ../common/uring_file.cpp ../common/cursor_source.cpp -I../common -lpthread $(pkg-config --cflags --libs gtk+-3.0 gtk-layer-shell-0)
  */
 
 #include <gtk/gtk.h>
@@ -21,20 +31,35 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/socket.h>
-#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <vector>
 #include <deque>
 #include <string>
 #include <filesystem>
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+#include "hypr_ipc.h"
+#include "trail_sample.h"
+#include "sample_ring.h"
+#include "trail_clock.h"
+#include "trail_log.h"
+#include "async_logger.h"
+#include "adaptive_sampler.h"
+#include "cursor_source.h"
+#include "uring_file.h"
+#include "trail_stream.h"
+#include "trail_store.h"
+#include "trail_view.h"
 
 using namespace std;
 
 // -- Types --
-struct Point {
-    int x, y;
-};
+typedef TrailPoint Point; // What TrailReader::ReadPoints() fills
 
 // -- Globals --
 GtkWidget* window_control;
@@ -44,22 +69,82 @@ GtkWidget* btn_start;
 GtkWidget* btn_stop;
 GtkWidget* chk_live;
 
-FILE* logFile = NULL;
+AsyncTrailLogger logWriter;
 bool isTracking = false;
 bool showLive = false;
 
+// Hyprland IPC (owned by the capture thread while tracking)
+HyprIpc g_hypr;
+
+class HyprCursorSource : public CursorSource {
+public:
+    bool GetPosition(int& x, int& y) override { return g_hypr.GetCursor(x, y); }
+};
+
+// Cursor sources, picked by CursorSource= on START
+HyprCursorSource g_hyprSource;
+ReplayCursorSource g_replaySource;
+SyntheticCursorSource* g_syntheticSource = nullptr;
+CursorSource* g_source = &g_hyprSource;
+
+// Capture thread -> GTK main loop
+SampleRing<TrailSample> g_ring(8192);
+std::thread g_captureThread;
+std::atomic<bool> g_captureRun(false);
+int g_wakePipe[2] = {-1, -1};
+guint g_drainTimer = 0;
+
 // Trail Data
 std::deque<Point> livePoints;
 std::vector<Point> staticPoints;
+TrailPointView g_reviewView; // Binary log / ring review, drawn from the file instead of staticPoints
+cairo_surface_t* g_reviewSurface = nullptr; // g_reviewView's trail, rendered once on the load thread
+
+// Review load thread -> GTK main loop, in batches
+const size_t LOAD_BATCH = 65536;
+const long long LOAD_REDRAW_NS = 200000000LL; // Redraw at most this often while loading
+std::thread g_loadThread;
+std::mutex g_loadLock;
+std::vector<Point> g_loadedPoints; // Handed over, not yet in staticPoints
+cairo_surface_t* g_loadedSurface = nullptr; // Handed over, not yet g_reviewSurface (under g_loadLock)
+std::atomic<unsigned long long> g_loadRendered(0); // Points drawn into it so far
+bool g_loadDone = false;           // Under g_loadLock
+bool g_loadIdle = false;           // An on_points_loaded is queued (under g_loadLock)
+std::atomic<bool> g_loadCancel(false);
+std::atomic<unsigned long long> g_loadEstimate(0);
+bool g_loading = false;            // GTK thread
+long long g_loadDrawn = 0;         // Last redraw while loading
+static void cancel_review_load();
 
 // Settings
 int g_interval = 20; // 50ms default
 int g_penWidth = 3;
 double g_colorR = 0.0, g_colorG = 1.0, g_colorB = 1.0;
 int g_trailLength = 20;
-bool g_autoClear = true;
+int g_autoClear = 1;      // 1 = truncate on START, 0 = append, 2 = ring file
+int g_ringFileMB = 64;
+bool g_segmented = false; // SegmentMB / SegmentMinutes set
+bool g_rotationFailing = false; // Last state reported by the logger
+int g_reviewMinutes = 0;  // 0 = review the latest session
+int g_parallelLoadMB = 64; // Text logs this large load on every core (0 = never)
+int g_loadThreads = 0;     // 0 = one per core
+TrailStore g_trailStore;   // This session's points, for the review
+long long g_sessionWallNs = 0; // When the latest session started
+int g_idleInterval = 250; // ms, rate used while the cursor is parked
+int g_idleAfter = 5;      // unchanged samples before switching to it
+char g_cursorSource[64] = "system"; // system | replay | synthetic
+char g_replayFile[256] = "replay_log.txt";
+TrailFormat g_logFormat = TRAIL_FORMAT_TEXT;
+bool g_logUring = false;  // LogBackend=uring
+bool g_logDirect = false; // LogDirect=1, with io_uring only
+TrailStream g_stream;      // --output, replaces the log
+TrailStreamFormat g_streamFormat = TRAIL_STREAM_FRAMED;
+TrailStreamFull g_streamFull = TRAIL_STREAM_BLOCK;
 
 const char* LOG_FILENAME = "mouse_log.txt";
+const char* LOG_FILENAME_BINARY = "mouse_log.bin";
+const char* LOG_FILENAME_RING = "mouse_log.ring";
+const char* LOG_SEGMENT_BASE = "mouse_log"; // + .manifest / .000001.txt
 const char* SETTINGS_FILENAME = "settings.ini";
 
 // -- Helper Functions --
@@ -93,6 +178,31 @@ int GetIniInt(const char* section, const char* key, int defVal) {
     return val;
 }
 
+void GetIniString(const char* section, const char* key, const char* defVal, char* out, size_t outSize) {
+    snprintf(out, outSize, "%s", defVal);
+    FILE* f = fopen(SETTINGS_FILENAME, "r");
+    if (!f) return;
+
+    char line[256];
+    char currentSection[64] = "";
+    bool inSection = false;
+
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '[') {
+            sscanf(line, "[%[^]]", currentSection);
+            inSection = (strcmp(currentSection, section) == 0);
+        } else if (inSection) {
+            char k[64], v[192];
+            if (sscanf(line, "%[^=]=%191s", k, v) == 2 && strcmp(k, key) == 0) {
+                snprintf(out, outSize, "%s", v);
+                break;
+            }
+        }
+    }
+    fclose(f);
+}
+
 void LoadSettings() {
     g_interval = GetIniInt("Settings", "Interval", 20);
     g_penWidth = GetIniInt("Settings", "PenWidth", 3);
@@ -102,50 +212,48 @@ void LoadSettings() {
     g_colorR = r / 255.0;
     g_colorG = g / 255.0;
     g_colorB = b / 255.0;
-    g_autoClear = GetIniInt("Settings", "AutoClear", 1) == 1;
+    g_autoClear = GetIniInt("Settings", "AutoClear", 1);
+    g_ringFileMB = GetIniInt("Settings", "RingFileMB", 64);
+    if (g_ringFileMB < 1) g_ringFileMB = 1;
+    if (g_ringFileMB > 2000) g_ringFileMB = 2000;
+    int segmentMB = GetIniInt("Settings", "SegmentMB", 0);
+    int segmentMinutes = GetIniInt("Settings", "SegmentMinutes", 0);
+    g_segmented = segmentMB > 0 || segmentMinutes > 0;
+    logWriter.SetSegmentLimits(segmentMB, segmentMinutes, GetIniInt("Settings", "SegmentKeep", 0));
+    logWriter.SetIndexEvery(GetIniInt("Settings", "IndexEvery", 1000));
+    g_reviewMinutes = GetIniInt("Settings", "ReviewMinutes", 0);
+    g_parallelLoadMB = GetIniInt("Settings", "ParallelLoadMB", 64);
+    g_loadThreads = GetIniInt("Settings", "LoadThreads", 0);
+    int reviewMemoryMB = GetIniInt("Settings", "ReviewMemoryMB", 256);
+    g_trailStore.SetLimit(reviewMemoryMB > 0 ? reviewMemoryMB * 1024ULL * 1024ULL : 0);
     g_trailLength = GetIniInt("Settings", "TrailLength", 20);
+    g_idleInterval = GetIniInt("Settings", "IdleInterval", 250);
+    g_idleAfter = GetIniInt("Settings", "IdleAfter", 5);
     
-    // Safety clamp interval
-    if (g_interval < 5) g_interval = 5;
-}
-
-// Hyprland Socket Reader for Cursor Pos
-bool GetHyprlandCursor(int& x, int& y) {
-    const char* sig = getenv("HYPRLAND_INSTANCE_SIGNATURE");
-    if (!sig) return false; // Not running Hyprland?
-
-    string socket_path = "/tmp/hypr/" + string(sig) + "/.socket.sock";
-
-    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (sock < 0) return false;
-
-    struct sockaddr_un addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sun_family = AF_UNIX;
-    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path)-1);
-
-    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        close(sock);
-        return false;
-    }
-
-    // Send command
-    const char* cmd = "cursorpos";
-    write(sock, cmd, strlen(cmd));
-
-    // Read response
-    char buffer[128];
-    int len = read(sock, buffer, sizeof(buffer)-1);
-    close(sock);
-
-    if (len > 0) {
-        buffer[len] = 0;
-        // Format is "123, 456"
-        if (sscanf(buffer,("%d, %d"), &x, &y) == 2) {
-            return true;
-        }
-    }
-    return false;
+    GetIniString("Settings", "CursorSource", "system", g_cursorSource, sizeof(g_cursorSource));
+    GetIniString("Settings", "ReplayFile", "replay_log.txt", g_replayFile, sizeof(g_replayFile));
+    char format[16];
+    GetIniString("Settings", "LogFormat", "text", format, sizeof(format));
+    g_logFormat = ParseTrailFormat(format);
+    char backend[16];
+    GetIniString("Settings", "LogBackend", "stdio", backend, sizeof(backend));
+    g_logUring = strcmp(backend, "uring") == 0;
+    g_logDirect = GetIniInt("Settings", "LogDirect", 0) == 1;
+    char streamFormat[16], streamFull[16];
+    GetIniString("Settings", "StreamFormat", "framed", streamFormat, sizeof(streamFormat));
+    GetIniString("Settings", "StreamFull", "block", streamFull, sizeof(streamFull));
+    g_streamFormat = ParseTrailStreamFormat(streamFormat);
+    g_streamFull = ParseTrailStreamFull(streamFull);
+
+    char durability[16];
+    GetIniString("Settings", "Durability", "none", durability, sizeof(durability));
+    logWriter.SetCommitPolicy(GetIniInt("Settings", "CommitSamples", 1000),
+                              GetIniInt("Settings", "CommitMs", 1000),
+                              ParseTrailDurability(durability));
+
+    // Safety clamp interval (spare the compositor; test sources may go faster)
+    bool systemCursor = strcmp(g_cursorSource, "system") == 0;
+    if (g_interval < (systemCursor ? 5 : 1)) g_interval = systemCursor ? 5 : 1;
 }
 
 // -- Draw Callbacks --
@@ -175,12 +283,22 @@ static gboolean on_draw_live_overlay(GtkWidget *widget, cairo_t *cr, gpointer da
     return FALSE;
 }
 
+static void close_review_view() {
+    g_reviewView.Close();
+    if (g_reviewSurface) cairo_surface_destroy(g_reviewSurface);
+    g_reviewSurface = nullptr;
+}
+
 static gboolean on_draw_static_trail(GtkWidget *widget, cairo_t *cr, gpointer data) {
     // Semi-transparent black background
     cairo_set_source_rgba(cr, 0, 0, 0, 0.7); 
     cairo_paint(cr);
 
-    if (staticPoints.size() > 1) {
+    if (g_reviewSurface) {
+        // Redraws (and the screenshot) repaint the rendered trail instead of reading the log again
+        cairo_set_source_surface(cr, g_reviewSurface, 0, 0);
+        cairo_paint(cr);
+    } else if (!g_reviewView.IsOpen() && staticPoints.size() > 1) {
         cairo_set_source_rgb(cr, g_colorR, g_colorG, g_colorB);
         cairo_set_line_width(cr, g_penWidth);
         
@@ -198,43 +316,224 @@ static gboolean on_draw_static_trail(GtkWidget *widget, cairo_t *cr, gpointer da
     cairo_move_to(cr, 50, 50);
     cairo_show_text(cr, "Press ESC to Close | Press S to Save Screenshot");
 
+    if (g_loading) {
+        // The estimate is rough, so the bar stops short of the end
+        unsigned long long estimate = g_loadEstimate;
+        unsigned long long loaded = g_reviewView.IsOpen() ? g_loadRendered.load() : staticPoints.size();
+        double done = estimate ? (double)loaded / estimate : 0.0;
+        if (done > 0.99) done = 0.99;
+        cairo_set_line_width(cr, 1);
+        cairo_rectangle(cr, 50.5, 70.5, 300, 8);
+        cairo_stroke(cr);
+        cairo_rectangle(cr, 50, 70, 300 * done, 9);
+        cairo_fill(cr);
+
+        char text[64];
+        snprintf(text, sizeof(text), "Loading... %llu points", loaded);
+        cairo_set_font_size(cr, 14);
+        cairo_move_to(cr, 50, 100);
+        cairo_show_text(cr, text);
+    }
+
     return FALSE;
 }
 
 // -- Logic --
 
-gboolean timer_tick(gpointer data) {
-    if (!isTracking) return FALSE; // stop timer
+static bool starts_with(const string& s, const char* prefix) {
+    return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+static void capture_sample(AdaptiveSampler& sampler) {
+    TrailSample s;
+    if (g_source->Sample(s)) {
+        g_ring.Push(s);
+        sampler.Next(s.x, s.y);
+    }
+}
 
-    int x, y;
-    if (GetHyprlandCursor(x, y)) {
-        // Log
-        if (logFile) {
-            fprintf(logFile, "%d,%d\n", x, y);
-            fflush(logFile);
+// Samples every g_interval ms (IdleInterval while the cursor is parked). .socket2.sock has no cursor motion events, but
+// focus / workspace / monitor changes usually mean the cursor just moved
+// somewhere interesting, so those trigger an extra sample right away.
+static void capture_thread() {
+    struct pollfd fds[2] = {
+        { g_wakePipe[0], POLLIN, 0 },
+        { g_source == &g_hyprSource && g_hypr.OpenEvents() ? g_hypr.GetEventFd() : -1, POLLIN, 0 }
+    };
+
+    AdaptiveSampler sampler;
+    sampler.Configure(g_interval, g_idleInterval, g_idleAfter);
+
+    // Absolute monotonic deadlines: IPC latency doesn't accumulate into drift
+    long long next = GetMonotonicNs();
+    while (g_captureRun.load()) {
+        long long now = GetMonotonicNs();
+        if (now >= next) {
+            capture_sample(sampler);
+            const long long intervalNs = (long long)sampler.GetInterval() * 1000000LL;
+            next += intervalNs;
+            if (next <= now) next = now + intervalNs; // Fell behind, don't burst
         }
 
-        // Live Trail
-        if (showLive && window_live_overlay) {
-            Point p = {x, y};
-            livePoints.push_back(p);
-            if (livePoints.size() > (size_t)g_trailLength) livePoints.pop_front();
-            gtk_widget_queue_draw(window_live_overlay);
+        long long wait = next - now > 0 ? next - now : 0;
+        struct timespec ts = { (time_t)(wait / 1000000000LL), (long)(wait % 1000000000LL) };
+        ppoll(fds, 2, &ts, NULL);
+
+        if (fds[1].fd >= 0 && fds[1].revents) {
+            vector<string> lines;
+            if (!g_hypr.ReadEvents(lines)) {
+                fds[1].fd = -1; // Stream closed, re-subscribed on next START
+                continue;
+            }
+            for (const string& line : lines) {
+                if (starts_with(line, "activewindow>>") ||
+                    starts_with(line, "workspace>>") ||
+                    starts_with(line, "focusedmon>>")) {
+                    capture_sample(sampler);
+                    // Woke up idle and the cursor moved: resume the fast rate now
+                    long long fast = GetMonotonicNs() + (long long)sampler.GetInterval() * 1000000LL;
+                    if (fast < next) next = fast;
+                    break;
+                }
+            }
         }
     }
 
+    g_hypr.CloseEvents();
+    g_hypr.Close();
+}
+
+const char* log_filename() {
+    if (g_autoClear == 2) return LOG_FILENAME_RING;
+    return g_logFormat != TRAIL_FORMAT_TEXT ? LOG_FILENAME_BINARY : LOG_FILENAME;
+}
+
+// LogBackend=uring submits through io_uring (and falls back to write() by itself)
+FILE* open_log_file(const char* path, const char* mode) {
+    if (g_logUring) return OpenUringFile(path, mode, g_logDirect);
+    return fopen(path, mode);
+}
+
+// Main thread only (GDK)
+static void get_monitor_size(int& w, int& h) {
+    GdkRectangle geo = { 0, 0, 1920, 1080 };
+    GdkMonitor* monitor = gdk_display_get_primary_monitor(gdk_display_get_default());
+    if (!monitor) monitor = gdk_display_get_monitor(gdk_display_get_default(), 0);
+    if (monitor) gdk_monitor_get_geometry(monitor, &geo);
+    w = geo.width;
+    h = geo.height;
+}
+
+// Main thread only (reads the monitor size from GDK)
+void select_cursor_source() {
+    g_source = &g_hyprSource;
+
+    if (strcmp(g_cursorSource, "replay") == 0) {
+        if (g_replaySource.Open(g_replayFile)) g_source = &g_replaySource;
+        else printf("WARNING: could not load ReplayFile %s, using Hyprland\n", g_replayFile);
+    } else if (strcmp(g_cursorSource, "synthetic") == 0) {
+        int w, h;
+        get_monitor_size(w, h);
+        delete g_syntheticSource;
+        g_syntheticSource = new SyntheticCursorSource(w, h);
+        g_source = g_syntheticSource;
+    }
+}
+
+void start_capture() {
+    select_cursor_source();
+    g_ring.Reset();
+    g_captureRun.store(true);
+    g_captureThread = std::thread(capture_thread);
+}
+
+void stop_capture() {
+    g_captureRun.store(false);
+    char c = 1;
+    if (write(g_wakePipe[1], &c, 1) < 0) {}
+    if (g_captureThread.joinable()) g_captureThread.join();
+
+    // Swallow the wake byte so the next session doesn't wake immediately
+    while (read(g_wakePipe[0], &c, 1) > 0) {}
+}
+
+// GTK side: log everything the capture thread queued, redraw once
+void drain_samples() {
+    TrailSample batch[256];
+    size_t n;
+    bool gotAny = false;
+
+    while ((n = g_ring.Drain(batch, 256)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            // Log
+            logWriter.Append(batch[i]);
+            g_trailStore.Append(batch[i]);
+
+            // Live Trail
+            if (showLive && window_live_overlay) {
+                Point p = {batch[i].x, batch[i].y};
+                livePoints.push_back(p);
+                if (livePoints.size() > (size_t)g_trailLength) livePoints.pop_front();
+            }
+        }
+        gotAny = true;
+    }
+
+    if (gotAny) {
+        logWriter.Flush();
+        if (showLive && window_live_overlay) gtk_widget_queue_draw(window_live_overlay);
+    }
+
+    if (logWriter.IsRotationFailing() != g_rotationFailing) {
+        g_rotationFailing = !g_rotationFailing;
+        if (g_rotationFailing) printf("WARNING: can't create the next log segment, still writing the current one\n");
+        else printf("Log segments rotating again\n");
+    }
+}
+
+gboolean drain_tick(gpointer data) {
+    if (!isTracking) {
+        g_drainTimer = 0;
+        return FALSE; // stop timer
+    }
+    drain_samples();
     return TRUE; // continue timer
 }
 
 // -- Actions --
 
+// New session in the log, as AutoClear says
+bool open_log() {
+    g_sessionWallNs = GetWallClockNs();
+    int screenW, screenH;
+    get_monitor_size(screenW, screenH);
+    if (g_stream.IsOpen()) {
+        logWriter.OpenStream(&g_stream, g_interval, screenW, screenH);
+        return true;
+    }
+    g_trailStore.Begin();
+    if (g_autoClear == 2) {
+        return logWriter.OpenRing(LOG_FILENAME_RING, (size_t)g_ringFileMB << 20, g_interval, screenW, screenH);
+    }
+    logWriter.SetFileOpener(open_log_file); // Segments open their own files
+    if (g_segmented) {
+        return logWriter.OpenSegments(LOG_SEGMENT_BASE, g_autoClear == 0, g_interval, g_logFormat, screenW, screenH);
+    }
+
+    const char* mode = g_autoClear ? "wb" : "ab";
+    FILE* f = open_log_file(log_filename(), mode);
+    if (!f) return false;
+    if (g_logUring && !IsUringFile(f)) printf("io_uring unavailable, logging with write()\n");
+    logWriter.Open(f, g_interval, g_logFormat, screenW, screenH, fopen((std::string(log_filename()) + ".idx").c_str(), mode));
+    return true;
+}
+
 void start_tracking() {
+    cancel_review_load(); // It may still be reading the file about to be reopened
+    close_review_view();
     LoadSettings(); // Reload in case it changed
 
-    const char* mode = g_autoClear ? "w" : "a";
-    logFile = fopen(LOG_FILENAME, mode);
-    
-    if (logFile) {
+    if (open_log()) {
         isTracking = true;
         livePoints.clear();
         
@@ -274,8 +573,10 @@ void start_tracking() {
             gtk_widget_show_all(window_live_overlay);
         }
 
-        // Start Timer
-        g_timeout_add(g_interval, timer_tick, NULL);
+        start_capture();
+
+        // Drain at the sample rate, but no faster than ~60 fps
+        g_drainTimer = g_timeout_add(g_interval > 16 ? g_interval : 16, drain_tick, NULL);
     }
 }
 
@@ -283,6 +584,8 @@ static gboolean on_key_press_static(GtkWidget *widget, GdkEventKey *event, gpoin
     if (event->keyval == GDK_KEY_Escape) {
         gtk_widget_destroy(widget);
         window_static_trail = nullptr;
+        cancel_review_load(); // Nothing left to show it in
+        close_review_view();
         return TRUE;
     }
     if (event->keyval == GDK_KEY_s || event->keyval == GDK_KEY_S) {
@@ -301,11 +604,208 @@ static gboolean on_key_press_static(GtkWidget *widget, GdkEventKey *event, gpoin
     return FALSE;
 }
 
+// GTK side: moves the batches handed over into staticPoints
+static gboolean on_points_loaded(gpointer data) {
+    bool done;
+    {
+        std::lock_guard<std::mutex> guard(g_loadLock);
+        g_loadIdle = false;
+        if (!g_loading) return FALSE; // Cancelled
+        if (staticPoints.empty()) staticPoints.swap(g_loadedPoints);
+        else staticPoints.insert(staticPoints.end(), g_loadedPoints.begin(), g_loadedPoints.end());
+        g_loadedPoints.clear();
+        done = g_loadDone;
+    }
+
+    if (done) {
+        g_loadThread.join();
+        g_loading = false;
+        g_reviewSurface = g_loadedSurface;
+        g_loadedSurface = nullptr;
+        if (staticPoints.empty() && !g_reviewSurface && window_static_trail) {
+            gtk_widget_destroy(window_static_trail); // Nothing to review
+            window_static_trail = nullptr;
+        }
+    }
+    long long now = GetMonotonicNs();
+    if (window_static_trail && (done || now - g_loadDrawn >= LOAD_REDRAW_NS)) {
+        g_loadDrawn = now;
+        gtk_widget_queue_draw(window_static_trail);
+    }
+    return FALSE; // Run once
+}
+
+// Load thread side; batch is left empty
+static void hand_over_points(std::vector<Point>& batch, bool done) {
+    std::lock_guard<std::mutex> guard(g_loadLock);
+    if (g_loadedPoints.empty()) g_loadedPoints.swap(batch);
+    else g_loadedPoints.insert(g_loadedPoints.end(), batch.begin(), batch.end());
+    batch.clear();
+    g_loadDone = done;
+    if (!g_loadIdle) {
+        g_loadIdle = true;
+        g_idle_add(on_points_loaded, NULL);
+    }
+}
+
+// TrailReader or TrailSegmentReader
+template <class Reader>
+void load_static_points(Reader& reader) {
+    TrailSample s;
+    long long count;
+    std::vector<Point> batch;
+    batch.reserve(LOAD_BATCH);
+    g_loadEstimate = reader.EstimateRecords();
+    // A run of n identical samples draws as a single vertex
+    while (!g_loadCancel && reader.Next(s, count)) {
+        batch.push_back({s.x, s.y});
+        if (batch.size() == LOAD_BATCH) hand_over_points(batch, false);
+    }
+    hand_over_points(batch, false);
+    if (reader.GetBadBlocks()) printf("WARNING: skipped %llu damaged log blocks\n", reader.GetBadBlocks());
+}
+
+// Puts a reader of the single-file log at the start of the review
+static void seek_review(TrailReader& reader, long long from, const std::string& path) {
+    if (from > 0 && reader.GetWallNs() != 0) {
+        // The index jumps straight to the review window
+        reader.OpenIndex(fopen((path + ".idx").c_str(), "rb"));
+        reader.SeekToTime(from - reader.GetWallNs() + reader.GetMonoNs());
+    } else if (from == 0) {
+        reader.SeekToLastSession(); // Older appended sessions aren't read at all
+    }
+}
+
+// Load thread: reads the review out of the log
+static void load_review(long long from, std::string path, long long sessionWallNs) {
+    if (g_segmented) {
+        // Only the segments overlapping the review window are opened
+        TrailSegmentReader reader;
+        if (reader.Open(TrailManifestPath(LOG_SEGMENT_BASE).c_str(), from ? from : sessionWallNs)) {
+            load_static_points(reader);
+        }
+    } else {
+        TrailReader reader;
+        if (reader.Open(fopen(path.c_str(), "rb"))) {
+            seek_review(reader, from, path);
+            // Parsed on every core, but handed over in one piece
+            std::vector<Point> points;
+            g_loadEstimate = reader.EstimateRecords();
+            if (g_parallelLoadMB > 0 &&
+                reader.ReadPoints(points, g_loadThreads, g_parallelLoadMB * 1024ULL * 1024ULL, &g_loadCancel)) {
+                hand_over_points(points, false);
+            } else {
+                load_static_points(reader);
+            }
+        }
+    }
+    std::vector<Point> none;
+    hand_over_points(none, true);
+}
+
+// Load thread: one pass over g_reviewView, straight from the mapped log a
+// batch at a time, into a surface the GTK side only ever paints. Nothing
+// else touches the view until this thread is joined.
+static void render_review(int width, int height) {
+    cairo_surface_t* surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+    cairo_t* cr = cairo_create(surface);
+    cairo_set_source_rgb(cr, g_colorR, g_colorG, g_colorB);
+    cairo_set_line_width(cr, g_penWidth);
+
+    g_loadEstimate = g_reviewView.GetReader().EstimateRecords();
+    std::vector<Point> none;
+    const TrailPoint* p;
+    size_t n;
+    bool first = true;
+    g_reviewView.Rewind();
+    while (!g_loadCancel && (n = g_reviewView.Next(p)) > 0) {
+        size_t i = 0;
+        if (first) {
+            cairo_move_to(cr, p[0].x, p[0].y);
+            i = 1;
+            first = false;
+        }
+        for (; i < n; ++i) cairo_line_to(cr, p[i].x, p[i].y);
+        // Stroked per batch so the path never holds the whole review
+        cairo_stroke(cr);
+        cairo_move_to(cr, p[n - 1].x, p[n - 1].y);
+        g_loadRendered += n;
+        hand_over_points(none, false); // Moves the progress bar
+    }
+    cairo_destroy(cr);
+    cairo_surface_flush(surface);
+    if (g_loadCancel) {
+        cairo_surface_destroy(surface);
+        surface = nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(g_loadLock);
+        g_loadedSurface = surface;
+    }
+    hand_over_points(none, true);
+}
+
+// Before anything touches staticPoints or the log again
+static void cancel_review_load() {
+    if (!g_loading) return;
+    g_loadCancel = true;
+    g_loadThread.join();
+    std::lock_guard<std::mutex> guard(g_loadLock);
+    g_loadedPoints.clear();
+    if (g_loadedSurface) cairo_surface_destroy(g_loadedSurface);
+    g_loadedSurface = nullptr;
+    g_loading = false;
+}
+
+static void show_static_trail() {
+    window_static_trail = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    
+    // Use Layer Shell "Top" mode to capture input
+    gtk_layer_init_for_window(GTK_WINDOW(window_static_trail));
+    gtk_layer_set_layer(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_LAYER_OVERLAY); // Or TOP
+    gtk_layer_set_anchor(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_EDGE_TOP, TRUE);
+    gtk_layer_set_anchor(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_EDGE_LEFT, TRUE);
+    gtk_layer_set_anchor(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_EDGE_RIGHT, TRUE);
+    gtk_layer_set_anchor(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_EDGE_BOTTOM, TRUE);
+    
+    // Exclusive (Keyboard)
+    gtk_layer_set_keyboard_mode(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_KEYBOARD_MODE_EXCLUSIVE);
+
+    // Transparent visual (glassy effect)
+    GdkScreen *screen = gtk_widget_get_screen(window_static_trail);
+    GdkVisual *visual = gdk_screen_get_rgba_visual(screen);
+    gtk_widget_set_visual(window_static_trail, visual);
+
+    g_signal_connect(G_OBJECT(window_static_trail), "draw", G_CALLBACK(on_draw_static_trail), NULL);
+    g_signal_connect(G_OBJECT(window_static_trail), "key-press-event", G_CALLBACK(on_key_press_static), NULL);
+    
+    gtk_widget_show_all(window_static_trail);
+    // Grab focus
+    gtk_widget_grab_focus(window_static_trail);
+}
+
 void stop_tracking() {
     isTracking = false;
-    if (logFile) {
-        fclose(logFile);
-        logFile = NULL;
+    stop_capture();
+    if (g_drainTimer) {
+        g_source_remove(g_drainTimer);
+        g_drainTimer = 0;
+    }
+    drain_samples(); // Don't lose the tail
+    printf("Capture: %llu dropped in %llu overflows (peak queue %zu of %zu)\n",
+           g_ring.GetDropped(), g_ring.GetOverflows(), g_ring.GetHighWater(), g_ring.Capacity());
+
+    logWriter.Close(); // Writes the tail, file is complete after this
+    printf("Log: %llu samples in %llu records, %llu commits (%llu synced)\n",
+           logWriter.GetSampleCount(), logWriter.GetRecordCount(),
+           logWriter.GetCommitCount(), logWriter.GetSyncCount());
+    printf("Logger: %llu batches, peak queue %zu, write latency last %.2f ms / max %.2f ms\n",
+           logWriter.GetBatchCount(), logWriter.GetMaxQueueDepth(),
+           logWriter.GetLastWriteNs() / 1e6, logWriter.GetMaxWriteNs() / 1e6);
+    if (g_stream.IsOpen()) {
+        printf("Stream: %llu samples sent, %llu dropped%s\n", logWriter.GetSampleCount(),
+               logWriter.GetDroppedCount(), g_stream.IsBroken() ? ", reader gone" : "");
     }
     
     if (window_live_overlay) {
@@ -315,58 +815,77 @@ void stop_tracking() {
 
     gtk_widget_set_sensitive(btn_start, TRUE);
     gtk_widget_set_sensitive(btn_stop, FALSE);
+    if (g_stream.IsOpen()) return; // Streamed, not logged: nothing to review
 
     // Load Points & Show Review
+    cancel_review_load();
+    close_review_view();
     staticPoints.clear();
-    FILE* f = fopen(LOG_FILENAME, "r");
-    if (f) {
-        char line[128];
-        int x, y;
-        while (fgets(line, sizeof(line), f)) {
-            if (sscanf(line, "%d,%d", &x, &y) == 2) {
-                staticPoints.push_back({x, y});
-            }
-        }
-        fclose(f);
+    long long from = g_reviewMinutes > 0 ? GetWallClockNs() - g_reviewMinutes * 60LL * 1000000000LL : 0;
+    // The log is only read back for earlier sessions (AutoClear=0 or ring)
+    // inside ReviewMinutes, or when this one outgrew ReviewMemoryMB
+    bool history = g_autoClear != 1 && from > 0 && from < g_trailStore.GetWallNs();
+    if (g_trailStore.IsComplete() && !history) {
+        g_trailStore.TakePoints(from, staticPoints);
+        if (!staticPoints.empty()) show_static_trail();
+        return;
     }
 
-    if (!staticPoints.empty()) {
-        window_static_trail = gtk_window_new(GTK_WINDOW_TOPLEVEL);
-        
-        // Use Layer Shell "Top" mode to capture input
-        gtk_layer_init_for_window(GTK_WINDOW(window_static_trail));
-        gtk_layer_set_layer(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_LAYER_OVERLAY); // Or TOP
-        gtk_layer_set_anchor(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_EDGE_TOP, TRUE);
-        gtk_layer_set_anchor(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_EDGE_LEFT, TRUE);
-        gtk_layer_set_anchor(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_EDGE_RIGHT, TRUE);
-        gtk_layer_set_anchor(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_EDGE_BOTTOM, TRUE);
-        
-        // Exclusive (Keyboard)
-        gtk_layer_set_keyboard_mode(GTK_WINDOW(window_static_trail), GTK_LAYER_SHELL_KEYBOARD_MODE_EXCLUSIVE);
-
-        // Transparent visual (glassy effect)
-        GdkScreen *screen = gtk_widget_get_screen(window_static_trail);
-        GdkVisual *visual = gdk_screen_get_rgba_visual(screen);
-        gtk_widget_set_visual(window_static_trail, visual);
-
-        g_signal_connect(G_OBJECT(window_static_trail), "draw", G_CALLBACK(on_draw_static_trail), NULL);
-        g_signal_connect(G_OBJECT(window_static_trail), "key-press-event", G_CALLBACK(on_key_press_static), NULL);
-        
-        gtk_widget_show_all(window_static_trail);
-        // Grab focus
-        gtk_widget_grab_focus(window_static_trail);
+    // The window comes up now and fills in as the load thread reads
+    g_loadCancel = false;
+    g_loadDone = false;
+    g_loadEstimate = 0;
+    g_loadRendered = 0;
+    g_loadDrawn = GetMonotonicNs();
+
+    // A binary log or ring is drawn straight from the file into a surface, no points kept
+    if (!g_segmented && g_reviewView.Open(fopen(log_filename(), "rb"))) {
+        seek_review(g_reviewView.GetReader(), from, log_filename());
+        const TrailPoint* first;
+        if (!g_reviewView.Rewind() || g_reviewView.Next(first) == 0) {
+            close_review_view();
+            return;
+        }
+        int screenW, screenH;
+        get_monitor_size(screenW, screenH);
+        g_loading = true;
+        g_loadThread = std::thread(render_review, screenW, screenH);
+        show_static_trail();
+        return;
     }
+
+    g_loading = true;
+    g_loadThread = std::thread(load_review, from, std::string(log_filename()), g_sessionWallNs);
+    show_static_trail();
 }
 
 int main(int argc, char **argv) {
     gtk_init(&argc, &argv);
+    const char* output = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) output = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--output -|PATH]\n", argv[0]);
+            return 1;
+        }
+    }
     
     // Check Hyprland
-    if (!getenv("HYPRLAND_INSTANCE_SIGNATURE")) {
+    if (!g_hypr.Init()) {
         printf("WARNING: HYPRLAND_INSTANCE_SIGNATURE not found. Tracking might fail.\n");
     }
 
     LoadSettings();
+    if (output) {
+        if (strcmp(output, "-") != 0) fprintf(stderr, "Opening %s (a FIFO waits for its reader)\n", output);
+        if (!g_stream.Open(output, g_streamFormat, g_streamFull)) {
+            fprintf(stderr, "Failed to open %s\n", output);
+            return 1;
+        }
+    }
+
+    if (pipe(g_wakePipe) < 0) return 1;
+    fcntl(g_wakePipe[0], F_SETFL, O_NONBLOCK);
 
     // Create Main Window
     window_control = gtk_window_new(GTK_WINDOW_TOPLEVEL);
@@ -395,6 +914,8 @@ int main(int argc, char **argv) {
 
     gtk_widget_show_all(window_control);
     gtk_main();
+    cancel_review_load();
+    close_review_view();
 
     return 0;
 }
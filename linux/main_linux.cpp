@@ -1,25 +1,71 @@
 /*
  * Mouse Tracker for Arch Linux (X11 + Cairo)
  * 
- * Dependencies: libx11, cairo
- * Compile: g++ -o mouse_tracker_linux main_linux.cpp -lX11 -lcairo -lpthread
+ * Dependencies: libx11, libxi, libxfixes, cairo
+ * Compile: g++ -o mouse_tracker_linux main_linux.cpp ../common/trail_log.cpp ../common/async_logger.cpp ../common/trail_ring.cpp ../common/trail_segments.cpp ../common/trail_columns.cpp ../common/trail_stream.cpp ../common/mapped_file.cpp ../common/uring_file.cpp ../common/cursor_source.cpp ../common/window_table.cpp -I../common -lX11 -lXi -lXfixes -lcairo -lpthread
+ *
+ * Interval=0 switches from XQueryPointer polling to XInput2 raw motion
+ * events, logging every motion at its X server time (mapped onto
+ * CLOCK_MONOTONIC) instead of one position per tick.
+ *
+ * Every sample carries a CLOCK_MONOTONIC ns timestamp (see common/trail_log.h),
+ * the mouse buttons held and the window under the cursor. Windows are
+ * interned (title fetched once) and logged as "# window" lines.
+ *
+ * CursorSource=replay / synthetic in settings.ini feeds the pipeline from a
+ * recorded log or a generator instead of the real pointer (load testing).
+ *
+ * Sampling runs on its own thread (with its own X connection) and hands
+ * samples to the UI loop through a lock-free ring, so slow overlay frames
+ * or disk stalls never delay the next sample.
+ *
+ * File writes happen on a logger thread (common/async_logger.h), so a slow
+ * disk can't stall the overlay either.
+ *
+ * --output - (or --output <fifo>) streams the samples to stdout or a FIFO
+ * instead of the log (see common/trail_stream.h).
+ *
+ * The UI loop sleeps in epoll on the X connection and a timerfd that is
+ * only armed while tracking, so an idle tracker never wakes up.
  */
 
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#include <X11/Xatom.h>
 #include <X11/extensions/XInput2.h>
+#include <X11/extensions/Xfixes.h>
+#include <X11/extensions/shape.h>
 #include <cairo/cairo.h>
 #include <cairo/cairo-xlib.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <vector>
 #include <deque>
 #include <string>
+#include <unordered_map>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
-#include <sys/time.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <atomic>
+
+#include "trail_sample.h"
+#include "sample_ring.h"
+#include "trail_clock.h"
+#include "trail_log.h"
+#include "async_logger.h"
+#include "adaptive_sampler.h"
+#include "cursor_source.h"
+#include "window_table.h"
+#include "uring_file.h"
+#include "trail_stream.h"
 
 // Types
 struct Point {
@@ -34,18 +80,50 @@ Window winOverlay; // For live trail
 Window root;
 bool isTracking = false;
 bool showLiveTrail = false;
-FILE* logFile = NULL;
+AsyncTrailLogger logWriter;
 std::vector<Point> trailPoints;
 std::deque<Point> livePoints;
 
+// Windows seen this session (filled by the capture thread)
+WindowTable g_windows;
+int g_windowsLogged = 0;              // IDs already written to the log
+std::vector<long long> g_windowTime;  // ns the cursor spent over each ID
+TrailSample g_lastSample;
+bool g_haveLastSample = false;
+
 // Settings
 int g_interval = 50;      // ms
 int g_penWidth = 2;
 double g_colorR = 0.0, g_colorG = 1.0, g_colorB = 1.0; // Cairo uses 0.0-1.0
 int g_trailLength = 20;
-bool g_autoClear = true;
+int g_autoClear = 1;      // 1 = truncate on START, 0 = append, 2 = ring file
+int g_ringFileMB = 64;
+bool g_segmented = false; // SegmentMB / SegmentMinutes set
+bool g_rotationFailing = false; // Last state reported by the logger
+int g_idleInterval = 250; // ms, rate used while the cursor is parked
+int g_idleAfter = 5;      // unchanged samples before switching to it
+char g_cursorSource[64] = "system"; // system | replay | synthetic
+char g_replayFile[256] = "replay_log.txt";
+TrailFormat g_logFormat = TRAIL_FORMAT_TEXT;
+bool g_logUring = false;  // LogBackend=uring
+bool g_logDirect = false; // LogDirect=1, with io_uring only
+TrailStream g_stream;      // --output, replaces the log
+TrailStreamFormat g_streamFormat = TRAIL_STREAM_FRAMED;
+TrailStreamFull g_streamFull = TRAIL_STREAM_BLOCK;
+
+// XInput2 (used when Interval=0)
+bool g_hasXI2 = false;
+
+// Capture thread -> UI loop
+SampleRing<TrailSample> g_ring(8192);
+std::thread g_captureThread;
+std::atomic<bool> g_captureRun(false);
+int g_wakePipe[2] = {-1, -1};
 
 const char* LOG_FILENAME = "mouse_log.txt";
+const char* LOG_FILENAME_BINARY = "mouse_log.bin";
+const char* LOG_FILENAME_RING = "mouse_log.ring";
+const char* LOG_SEGMENT_BASE = "mouse_log"; // + .manifest / .000001.txt
 const char* SETTINGS_FILENAME = "settings.ini";
 
 // Helper to read INI (simplified for Linux)
@@ -80,6 +158,31 @@ int GetIniInt(const char* section, const char* key, int defVal) {
     return val;
 }
 
+void GetIniString(const char* section, const char* key, const char* defVal, char* out, size_t outSize) {
+    snprintf(out, outSize, "%s", defVal);
+    FILE* f = fopen(SETTINGS_FILENAME, "r");
+    if (!f) return;
+
+    char line[256];
+    char currentSection[64] = "";
+    bool inSection = false;
+
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (line[0] == '[') {
+            sscanf(line, "[%[^]]", currentSection);
+            inSection = (strcmp(currentSection, section) == 0);
+        } else if (inSection) {
+            char k[64], v[192];
+            if (sscanf(line, "%[^=]=%191s", k, v) == 2 && strcmp(k, key) == 0) {
+                snprintf(out, outSize, "%s", v);
+                break;
+            }
+        }
+    }
+    fclose(f);
+}
+
 void LoadSettings() {
     g_interval = GetIniInt("Settings", "Interval", 50);
     g_penWidth = GetIniInt("Settings", "PenWidth", 2);
@@ -89,10 +192,167 @@ void LoadSettings() {
     g_colorR = r / 255.0;
     g_colorG = g / 255.0;
     g_colorB = b / 255.0;
-    g_autoClear = GetIniInt("Settings", "AutoClear", 1) == 1;
+    g_autoClear = GetIniInt("Settings", "AutoClear", 1);
+    g_ringFileMB = GetIniInt("Settings", "RingFileMB", 64);
+    if (g_ringFileMB < 1) g_ringFileMB = 1;
+    if (g_ringFileMB > 2000) g_ringFileMB = 2000;
+    int segmentMB = GetIniInt("Settings", "SegmentMB", 0);
+    int segmentMinutes = GetIniInt("Settings", "SegmentMinutes", 0);
+    g_segmented = segmentMB > 0 || segmentMinutes > 0;
+    logWriter.SetSegmentLimits(segmentMB, segmentMinutes, GetIniInt("Settings", "SegmentKeep", 0));
+    logWriter.SetIndexEvery(GetIniInt("Settings", "IndexEvery", 1000));
     g_trailLength = GetIniInt("Settings", "TrailLength", 20);
+    g_idleInterval = GetIniInt("Settings", "IdleInterval", 250);
+    g_idleAfter = GetIniInt("Settings", "IdleAfter", 5);
+    GetIniString("Settings", "CursorSource", "system", g_cursorSource, sizeof(g_cursorSource));
+    GetIniString("Settings", "ReplayFile", "replay_log.txt", g_replayFile, sizeof(g_replayFile));
+    char format[16];
+    GetIniString("Settings", "LogFormat", "text", format, sizeof(format));
+    g_logFormat = ParseTrailFormat(format);
+    char backend[16];
+    GetIniString("Settings", "LogBackend", "stdio", backend, sizeof(backend));
+    g_logUring = strcmp(backend, "uring") == 0;
+    g_logDirect = GetIniInt("Settings", "LogDirect", 0) == 1;
+    char streamFormat[16], streamFull[16];
+    GetIniString("Settings", "StreamFormat", "framed", streamFormat, sizeof(streamFormat));
+    GetIniString("Settings", "StreamFull", "block", streamFull, sizeof(streamFull));
+    g_streamFormat = ParseTrailStreamFormat(streamFormat);
+    g_streamFull = ParseTrailStreamFull(streamFull);
+
+    char durability[16];
+    GetIniString("Settings", "Durability", "none", durability, sizeof(durability));
+    logWriter.SetCommitPolicy(GetIniInt("Settings", "CommitSamples", 1000),
+                              GetIniInt("Settings", "CommitMs", 1000),
+                              ParseTrailDurability(durability));
+}
+
+const char* LogFileName() {
+    if (g_autoClear == 2) return LOG_FILENAME_RING;
+    return g_logFormat != TRAIL_FORMAT_TEXT ? LOG_FILENAME_BINARY : LOG_FILENAME;
+}
+
+// LogBackend=uring submits through io_uring (and falls back to write() by itself)
+FILE* OpenLogFile(const char* path, const char* mode) {
+    if (g_logUring) return OpenUringFile(path, mode, g_logDirect);
+    return fopen(path, mode);
+}
+
+bool UsingSystemCursor() {
+    return strcmp(g_cursorSource, "system") == 0;
 }
 
+// A window can close between XQueryPointer and its title lookup; don't let
+// the default handler exit over that
+int OnXError(Display* d, XErrorEvent* e) {
+    if (e->error_code == BadWindow) return 0;
+    char msg[128];
+    XGetErrorText(d, e->error_code, msg, sizeof(msg));
+    fprintf(stderr, "X error: %s\n", msg);
+    return 0;
+}
+
+// Core pointer state (Button1Mask..Button5Mask) -> TRAIL_BUTTON_* bits
+unsigned int ButtonsFromState(unsigned int state) {
+    return (state >> 8) & 0x1f;
+}
+
+// Maps the top-level window under the pointer to a g_windows ID. The title
+// is fetched once per window, later samples only hit the local cache.
+class X11WindowResolver {
+public:
+    explicit X11WindowResolver(Display* d) : m_dpy(d), m_wmState(XInternAtom(d, "WM_STATE", False)) {}
+
+    int Resolve(Window top) {
+        if (top == None) return 0;
+        std::unordered_map<Window, int>::iterator it = m_cache.find(top);
+        if (it != m_cache.end()) return it->second;
+
+        Window client = FindClient(top, 0);
+        if (client == None) client = top;
+
+        std::string title;
+        char* name = NULL;
+        XClassHint hint;
+        if (XFetchName(m_dpy, client, &name) && name) {
+            title = name;
+            XFree(name);
+        } else if (XGetClassHint(m_dpy, client, &hint)) {
+            // No WM_NAME, the class still names the application
+            if (hint.res_class) title = hint.res_class;
+            if (hint.res_name) XFree(hint.res_name);
+            if (hint.res_class) XFree(hint.res_class);
+        }
+
+        int id = g_windows.Intern(client, title.c_str());
+        m_cache[top] = id;
+        return id;
+    }
+
+private:
+    bool HasWmState(Window w) {
+        Atom type = None;
+        int format;
+        unsigned long count, after;
+        unsigned char* data = NULL;
+        if (XGetWindowProperty(m_dpy, w, m_wmState, 0, 0, False, AnyPropertyType,
+                               &type, &format, &count, &after, &data) != Success) return false;
+        if (data) XFree(data);
+        return type != None;
+    }
+
+    // With a reparenting WM the child of root is the frame; the
+    // application's window is the descendant that has WM_STATE
+    Window FindClient(Window w, int depth) {
+        if (HasWmState(w)) return w;
+        if (depth >= 3) return None;
+
+        Window r, parent, *children = NULL;
+        unsigned int count = 0;
+        if (!XQueryTree(m_dpy, w, &r, &parent, &children, &count)) return None;
+
+        Window found = None;
+        for (unsigned int i = count; i-- > 0 && found == None;) found = FindClient(children[i], depth + 1);
+        if (children) XFree(children);
+        return found;
+    }
+
+    Display* m_dpy;
+    Atom m_wmState;
+    std::unordered_map<Window, int> m_cache;
+};
+
+// The real pointer. Lives on the capture thread's own connection.
+class X11CursorSource : public CursorSource {
+public:
+    explicit X11CursorSource(Display* d) : m_dpy(d), m_root(DefaultRootWindow(d)), m_windows(d) {}
+
+    bool GetPosition(int& x, int& y) override {
+        Window root_return, child_return;
+        int win_x, win_y;
+        unsigned int mask_return;
+        return XQueryPointer(m_dpy, m_root, &root_return, &child_return,
+                             &x, &y, &win_x, &win_y, &mask_return);
+    }
+
+    // Same round trip, but keeps the button mask and the window under the cursor
+    bool Sample(TrailSample& s) override {
+        Window root_return, child_return;
+        int win_x, win_y;
+        unsigned int mask_return;
+        if (!XQueryPointer(m_dpy, m_root, &root_return, &child_return,
+                           &s.x, &s.y, &win_x, &win_y, &mask_return)) return false;
+        s.t = GetMonotonicNs();
+        s.buttons = ButtonsFromState(mask_return);
+        s.window = m_windows.Resolve(child_return);
+        return true;
+    }
+
+private:
+    Display* m_dpy;
+    Window m_root;
+    X11WindowResolver m_windows;
+};
+
 void DrawButton(Window w, const char* label, int x, int y, int width, int height, bool active) {
     cairo_surface_t* surface = cairo_xlib_surface_create(dpy, w, DefaultVisual(dpy, screen), 250, 200);
     cairo_t* cr = cairo_create(surface);
@@ -178,19 +438,345 @@ void DrawOverlay() {
     XFlush(dpy);
 }
 
-long long GetTimeMs() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+// XInput2 needs at least 2.1 for raw events on master devices.
+// Has to be called once per connection before selecting XI2 events.
+bool InitXInput2(Display* d, int* opcode) {
+    int event, error;
+    if (!XQueryExtension(d, "XInputExtension", opcode, &event, &error)) return false;
+
+    int major = 2, minor = 1;
+    if (XIQueryVersion(d, &major, &minor) != Success) return false;
+    return major > 2 || (major == 2 && minor >= 1);
+}
+
+// Subscribe to raw motion and buttons on the root window. Raw events reach
+// root whatever window is under the cursor and whoever else selected
+// ButtonPress there (the WM usually has), but carry no position.
+void SelectXI2Motion(Display* d) {
+    unsigned char bits[XIMaskLen(XI_LASTEVENT)];
+    memset(bits, 0, sizeof(bits));
+    XISetMask(bits, XI_RawMotion);
+    XISetMask(bits, XI_RawButtonPress);
+    XISetMask(bits, XI_RawButtonRelease);
+
+    XIEventMask mask;
+    mask.deviceid = XIAllMasterDevices;
+    mask.mask_len = sizeof(bits);
+    mask.mask = bits;
+    XISelectEvents(d, DefaultRootWindow(d), &mask, 1);
+    XFlush(d);
+}
+
+// Maps X server timestamps (32-bit ms, wrapping every 49 days) onto
+// CLOCK_MONOTONIC. Delivery only ever adds latency, so the smallest
+// arrival - server time seen this session is the offset.
+class XServerClock {
+public:
+    XServerClock() : m_offset(0), m_last(0), m_wraps(0), m_valid(false) {}
+
+    long long ToMonotonic(Time serverMs, long long arrival) {
+        unsigned int ms = (unsigned int)serverMs;
+        if (m_valid && ms < m_last && m_last - ms > 0x80000000u) m_wraps++;
+        m_last = ms;
+        long long server = ((long long)m_wraps << 32 | ms) * 1000000LL;
+        if (!m_valid || arrival - server < m_offset) m_offset = arrival - server;
+        m_valid = true;
+        return server + m_offset;
+    }
+
+private:
+    long long m_offset;
+    unsigned int m_last;
+    long long m_wraps;
+    bool m_valid;
+};
+
+struct XI2RawEvent {
+    int type;
+    Time time;
+    int detail;
+};
+
+// The batch's position at time t, unless nothing changed since the last sample
+void PushXI2Sample(const TrailSample& at, long long t, unsigned int buttons, TrailSample& last) {
+    TrailSample s = at;
+    s.t = t;
+    s.buttons = buttons;
+    if (s.x == last.x && s.y == last.y && s.buttons == last.buttons && s.window == last.window) return;
+    last = s;
+    g_ring.Push(s);
+}
+
+// Blocks on the X connection until motion arrives or StopCapture() wakes us.
+// Each drained batch costs one XQueryPointer for the position and window;
+// its samples keep the server time of the raw events behind them.
+void CaptureXI2(Display* d) {
+    int opcode;
+    if (!InitXInput2(d, &opcode)) return;
+    SelectXI2Motion(d);
+
+    // Raw details are physical buttons; left-handed setups swap 1 and 3
+    unsigned char map[256];
+    int mapped = XGetPointerMapping(d, map, sizeof(map));
+
+    X11CursorSource pointer(d);
+    XServerClock clock;
+    std::vector<XI2RawEvent> batch;
+    TrailSample last;
+    last.x = last.y = -1;
+    unsigned int buttons = pointer.Sample(last) ? last.buttons : 0;
+    struct pollfd fds[2] = {
+        { ConnectionNumber(d), POLLIN, 0 },
+        { g_wakePipe[0], POLLIN, 0 }
+    };
+
+    while (g_captureRun.load()) {
+        batch.clear();
+        while (XPending(d) > 0) {
+            XEvent ev;
+            XNextEvent(d, &ev);
+            if (ev.xcookie.type != GenericEvent || ev.xcookie.extension != opcode) continue;
+            if (!XGetEventData(d, &ev.xcookie)) continue;
+            XIRawEvent* re = (XIRawEvent*)ev.xcookie.data;
+            XI2RawEvent e = { ev.xcookie.evtype, re->time, re->detail };
+            XFreeEventData(d, &ev.xcookie);
+            if (e.type == XI_RawMotion || e.type == XI_RawButtonPress || e.type == XI_RawButtonRelease) {
+                batch.push_back(e);
+            }
+        }
+
+        TrailSample now;
+        if (!batch.empty() && pointer.Sample(now)) {
+            long long arrival = now.t;
+            bool moved = false;
+            Time motionTime = 0;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const XI2RawEvent& e = batch[i];
+                if (e.type == XI_RawMotion) {
+                    moved = true;
+                    motionTime = e.time;
+                    continue;
+                }
+                // Wheel clicks (4+) are press/release pairs with no held state
+                int button = e.detail >= 1 && e.detail <= mapped ? map[e.detail - 1] : 0;
+                if (button < 1 || button > 3) continue;
+
+                // Motion before the press/release goes out first
+                if (moved) PushXI2Sample(now, clock.ToMonotonic(motionTime, arrival), buttons, last);
+                moved = false;
+                if (e.type == XI_RawButtonPress) buttons |= 1u << (button - 1);
+                else buttons &= ~(1u << (button - 1));
+                PushXI2Sample(now, clock.ToMonotonic(e.time, arrival), buttons, last);
+            }
+            if (moved) PushXI2Sample(now, clock.ToMonotonic(motionTime, arrival), buttons, last);
+            // The server's mask settles anything the raw events missed
+            buttons = now.buttons;
+        }
+        poll(fds, 2, -1);
+    }
+}
+
+// Ticks are scheduled on absolute monotonic deadlines, so query time
+// doesn't accumulate into drift and clock adjustments can't stall the loop.
+// The interval backs off to IdleInterval while the cursor is parked.
+void CapturePolling(CursorSource& source) {
+    struct pollfd wake = { g_wakePipe[0], POLLIN, 0 };
+    AdaptiveSampler sampler;
+    sampler.Configure(g_interval, g_idleInterval, g_idleAfter);
+    long long next = GetMonotonicNs();
+
+    while (g_captureRun.load()) {
+        TrailSample s;
+        if (source.Sample(s)) {
+            g_ring.Push(s);
+            sampler.Next(s.x, s.y);
+        }
+
+        const long long intervalNs = (long long)sampler.GetInterval() * 1000000LL;
+        next += intervalNs;
+        long long now = GetMonotonicNs();
+        if (next <= now) next = now + intervalNs; // Fell behind, don't burst
+
+        // Sleeps until the next deadline, returns early on stop
+        long long wait = next - now;
+        struct timespec ts = { (time_t)(wait / 1000000000LL), (long)(wait % 1000000000LL) };
+        ppoll(&wake, 1, &ts, NULL);
+    }
+}
+
+// Own connection: Xlib displays must not be shared across threads without XInitThreads
+void CaptureThread() {
+    Display* d = XOpenDisplay(NULL);
+    if (!d) return;
+
+    if (!UsingSystemCursor()) {
+        ReplayCursorSource replay;
+        SyntheticCursorSource synthetic(DisplayWidth(d, DefaultScreen(d)), DisplayHeight(d, DefaultScreen(d)));
+        if (strcmp(g_cursorSource, "replay") == 0) {
+            if (replay.Open(g_replayFile)) CapturePolling(replay);
+            else printf("WARNING: could not load ReplayFile %s\n", g_replayFile);
+        } else {
+            CapturePolling(synthetic);
+        }
+    } else if (g_interval == 0) {
+        CaptureXI2(d);
+    } else {
+        X11CursorSource pointer(d);
+        CapturePolling(pointer);
+    }
+
+    XCloseDisplay(d);
+}
+
+void StartCapture() {
+    g_ring.Reset();
+    g_captureRun.store(true);
+    g_captureThread = std::thread(CaptureThread);
+}
+
+void StopCapture() {
+    g_captureRun.store(false);
+    char c = 1;
+    if (write(g_wakePipe[1], &c, 1) < 0) {}
+    if (g_captureThread.joinable()) g_captureThread.join();
+
+    // Swallow the wake byte so the next session doesn't wake immediately
+    while (read(g_wakePipe[0], &c, 1) > 0) {}
+}
+
+// Writes "# window" lines for IDs the capture thread added up to id
+void LogWindowsUpTo(int id) {
+    unsigned long long handle;
+    std::string name;
+    while (g_windowsLogged < id && g_windows.Get(g_windowsLogged + 1, handle, name)) {
+        g_windowsLogged++;
+        logWriter.WriteWindow(g_windowsLogged, handle, name.c_str());
+    }
+}
+
+// Time between two samples goes to the window the cursor was over
+void AddWindowTime(const TrailSample& s) {
+    if (g_haveLastSample && g_lastSample.window > 0) {
+        if ((size_t)g_lastSample.window >= g_windowTime.size()) g_windowTime.resize(g_lastSample.window + 1, 0);
+        g_windowTime[g_lastSample.window] += s.t - g_lastSample.t;
+    }
+    g_lastSample = s;
+    g_haveLastSample = true;
+}
+
+void PrintWindowTime() {
+    std::vector<std::pair<long long, int> > order;
+    for (size_t id = 1; id < g_windowTime.size(); ++id) {
+        if (g_windowTime[id] > 0) order.push_back(std::make_pair(g_windowTime[id], (int)id));
+    }
+    std::sort(order.rbegin(), order.rend());
+
+    unsigned long long handle;
+    std::string name;
+    for (size_t i = 0; i < order.size() && i < 5; ++i) {
+        if (!g_windows.Get(order[i].second, handle, name)) continue;
+        printf("  %8.1fs  %s\n", order[i].first / 1e9, name.empty() ? "(untitled)" : name.c_str());
+    }
+}
+
+// UI side: log everything the capture thread queued, redraw once
+void DrainSamples() {
+    TrailSample batch[256];
+    size_t n;
+    bool gotAny = false;
+
+    while ((n = g_ring.Drain(batch, 256)) > 0) {
+        for (size_t i = 0; i < n; ++i) {
+            // Log
+            if (batch[i].window > g_windowsLogged) LogWindowsUpTo(batch[i].window);
+            logWriter.Append(batch[i]);
+            AddWindowTime(batch[i]);
+
+            // Live Trail logic
+            if (showLiveTrail) {
+                Point p = {batch[i].x, batch[i].y};
+                livePoints.push_back(p);
+                if (livePoints.size() > (size_t)g_trailLength) livePoints.pop_front();
+            }
+        }
+        gotAny = true;
+    }
+
+    if (gotAny) {
+        logWriter.Flush();
+        if (showLiveTrail) DrawOverlay();
+    }
+
+    if (logWriter.IsRotationFailing() != g_rotationFailing) {
+        g_rotationFailing = !g_rotationFailing;
+        if (g_rotationFailing) printf("WARNING: can't create the next log segment, still writing the current one\n");
+        else printf("Log segments rotating again\n");
+    }
+}
+
+// New session in the log, as AutoClear says
+bool OpenLog() {
+    int w = DisplayWidth(dpy, screen), h = DisplayHeight(dpy, screen);
+    if (g_stream.IsOpen()) {
+        logWriter.OpenStream(&g_stream, g_interval, w, h);
+        return true;
+    }
+    if (g_autoClear == 2) return logWriter.OpenRing(LOG_FILENAME_RING, (size_t)g_ringFileMB << 20, g_interval, w, h);
+    logWriter.SetFileOpener(OpenLogFile); // Segments open their own files
+    if (g_segmented) return logWriter.OpenSegments(LOG_SEGMENT_BASE, g_autoClear == 0, g_interval, g_logFormat, w, h);
+
+    const char* mode = g_autoClear ? "wb" : "ab";
+    FILE* f = OpenLogFile(LogFileName(), mode);
+    if (!f) return false;
+    if (g_logUring && !IsUringFile(f)) printf("io_uring unavailable, logging with write()\n");
+    logWriter.Open(f, g_interval, g_logFormat, w, h, fopen((std::string(LogFileName()) + ".idx").c_str(), mode));
+    return true;
+}
+
+// Periodic drain while tracking; 0 disarms
+void ArmDrainTimer(int tfd, int ms) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = ms / 1000;
+    its.it_value.tv_nsec = (long)(ms % 1000) * 1000000L;
+    its.it_interval = its.it_value;
+    timerfd_settime(tfd, 0, &its, NULL);
 }
 
-int main() {
+int main(int argc, char** argv) {
+    const char* output = NULL;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) output = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--output -|PATH]\n", argv[0]);
+            return 1;
+        }
+    }
+
     dpy = XOpenDisplay(NULL);
     if (!dpy) return 1;
     screen = DefaultScreen(dpy);
     root = DefaultRootWindow(dpy);
+    XSetErrorHandler(OnXError);
 
     LoadSettings();
+    if (output) {
+        if (strcmp(output, "-") != 0) fprintf(stderr, "Opening %s (a FIFO waits for its reader)\n", output);
+        if (!g_stream.Open(output, g_streamFormat, g_streamFull)) {
+            fprintf(stderr, "Failed to open %s\n", output);
+            return 1;
+        }
+    }
+    int xiOpcode;
+    g_hasXI2 = InitXInput2(dpy, &xiOpcode);
+    if (g_interval == 0 && !g_hasXI2) {
+        printf("WARNING: XInput 2.1 not available, falling back to 1ms polling.\n");
+        g_interval = 1;
+    }
+    if (g_interval == 0 && !UsingSystemCursor()) g_interval = 1; // XI2 only exists for the real pointer
+
+    if (pipe(g_wakePipe) < 0) return 1;
+    fcntl(g_wakePipe[0], F_SETFL, O_NONBLOCK);
 
     // Create Control Window
     winControl = XCreateSimpleWindow(dpy, root, 100, 100, 250, 140, 1, 
@@ -199,8 +785,22 @@ int main() {
     XStoreName(dpy, winControl, "Mouse Tracker");
     XMapWindow(dpy, winControl);
 
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    int drainTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (epfd < 0 || drainTimer < 0) return 1;
+
+    struct epoll_event reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.events = EPOLLIN;
+    reg.data.fd = ConnectionNumber(dpy);
+    epoll_ctl(epfd, EPOLL_CTL_ADD, reg.data.fd, &reg);
+    reg.data.fd = drainTimer;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, reg.data.fd, &reg);
+
+    // Drain at the sample rate, but no faster than ~60 fps (the capture
+    // thread keeps the exact cadence either way)
+    int drainMs = g_interval > 16 ? g_interval : 16;
     bool running = true;
-    long long lastTick = GetTimeMs();
 
     while (running) {
         // Event Loop
@@ -219,12 +819,16 @@ int main() {
                 // Start
                 if (y >= 10 && y <= 60 && x >= 10 && x <= 110) {
                     if (!isTracking) {
-                        const char* mode = g_autoClear ? "w" : "a";
-                        logFile = fopen(LOG_FILENAME, mode);
-                        if (logFile) {
+                        if (OpenLog()) {
                             isTracking = true;
                             livePoints.clear();
+                            g_windows.Clear();
+                            g_windowsLogged = 0;
+                            g_windowTime.clear();
+                            g_haveLastSample = false;
                             if (showLiveTrail) winOverlay = CreateOverlayWindow();
+                            StartCapture();
+                            ArmDrainTimer(drainTimer, drainMs);
                         }
                     }
                 }
@@ -232,7 +836,30 @@ int main() {
                 else if (y >= 10 && y <= 60 && x >= 120 && x <= 220) {
                     if (isTracking) {
                         isTracking = false;
-                        if (logFile) { fclose(logFile); logFile = NULL; }
+                        ArmDrainTimer(drainTimer, 0);
+                        StopCapture();
+                        DrainSamples(); // Don't lose the tail
+                        printf("Capture: %llu dropped in %llu overflows (peak queue %zu of %zu)\n",
+                               g_ring.GetDropped(), g_ring.GetOverflows(),
+                               g_ring.GetHighWater(), g_ring.Capacity());
+                        logWriter.Close(); // Writes the tail, file is complete after this
+                        printf("Log: %llu samples in %llu records, %d windows, %llu commits (%llu synced)\n",
+                               logWriter.GetSampleCount(), logWriter.GetRecordCount(), g_windows.Size(),
+                               logWriter.GetCommitCount(), logWriter.GetSyncCount());
+                        if (g_stream.IsOpen()) {
+                            printf("Stream: %llu samples sent, %llu dropped%s\n", logWriter.GetSampleCount(),
+                                   logWriter.GetDroppedCount(), g_stream.IsBroken() ? ", reader gone" : "");
+                        }
+                        if (logWriter.GetSegmentCount()) {
+                            printf("Segments: %llu this session (%llu failed rotations), listed in %s\n",
+                                   logWriter.GetSegmentCount(), logWriter.GetRotateFailureCount(),
+                                   TrailManifestPath(LOG_SEGMENT_BASE).c_str());
+                            g_rotationFailing = false;
+                        }
+                        printf("Logger: %llu batches, peak queue %zu, write latency last %.2f ms / max %.2f ms\n",
+                               logWriter.GetBatchCount(), logWriter.GetMaxQueueDepth(),
+                               logWriter.GetLastWriteNs() / 1e6, logWriter.GetMaxWriteNs() / 1e6);
+                        PrintWindowTime();
                         if (winOverlay) { XDestroyWindow(dpy, winOverlay); winOverlay = 0; }
                     }
                 }
@@ -246,37 +873,20 @@ int main() {
             }
         }
 
-        // Logic Loop (Timer)
-        long long now = GetTimeMs();
-        if (isTracking && (now - lastTick >= g_interval)) {
-            lastTick = now;
-            
-            Window root_return, child_return;
-            int root_x, root_y, win_x, win_y;
-            unsigned int mask_return;
-            
-            if (XQueryPointer(dpy, root, &root_return, &child_return, 
-                              &root_x, &root_y, &win_x, &win_y, &mask_return)) {
-                
-                // Log
-                if (logFile) {
-                    fprintf(logFile, "%d,%d\n", root_x, root_y);
-                    fflush(logFile);
-                }
-
-                // Live Trail logic
-                if (showLiveTrail) {
-                    Point p = {root_x, root_y};
-                    livePoints.push_back(p);
-                    if (livePoints.size() > (size_t)g_trailLength) livePoints.pop_front();
-                    DrawOverlay();
-                }
+        // Everything Xlib had buffered is handled; sleep until the server or the timer has more
+        struct epoll_event events[4];
+        int n = epoll_wait(epfd, events, 4, -1);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == drainTimer) {
+                uint64_t expirations;
+                if (read(drainTimer, &expirations, sizeof(expirations)) < 0) {}
+                if (isTracking) DrainSamples();
             }
         }
-
-        usleep(1000); // 1ms sleep to save CPU
     }
 
+    close(drainTimer);
+    close(epfd);
     XCloseDisplay(dpy);
     return 0;
 }
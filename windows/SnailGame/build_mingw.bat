@@ -1,6 +1,6 @@
 @echo off
 echo Attempting to build Snail Game with MinGW (g++)...
-g++ -o SnailGame.exe main.cpp snail_game.cpp -lgdi32 -lgdiplus -mwindows
+g++ -o SnailGame.exe main.cpp snail_game.cpp ../../common/cursor_source.cpp ../../common/trail_log.cpp ../../common/trail_columns.cpp ../../common/mapped_file.cpp -I../../common -lgdi32 -lgdiplus -mwindows
 if %ERRORLEVEL% EQU 0 (
     echo.
     echo ---------------------------------------
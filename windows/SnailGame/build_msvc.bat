@@ -1,6 +1,6 @@
 @echo off
 echo Attempting to build Snail Game with MSVC (cl.exe)...
-cl.exe /nologo /O1 main.cpp snail_game.cpp user32.lib gdi32.lib gdiplus.lib /Fe:SnailGame.exe
+cl.exe /nologo /O1 /I..\..\common main.cpp snail_game.cpp ..\..\common\cursor_source.cpp ..\..\common\trail_log.cpp ..\..\common\trail_columns.cpp ..\..\common\mapped_file.cpp user32.lib gdi32.lib gdiplus.lib /Fe:SnailGame.exe
 if %ERRORLEVEL% EQU 0 (
     echo.
     echo ---------------------------------------
@@ -16,6 +16,10 @@ const wchar_t CONTROL_CLASS_NAME[] = L"SnailControlClass";
 const wchar_t OVERLAY_CLASS_NAME[] = L"SnailOverlayClass";
 
 SnailGame g_snailGame;
+
+// Cursor sources (CursorSource= system | replay | synthetic in settings.ini)
+ReplayCursorSource g_replaySource;
+SyntheticCursorSource g_syntheticSource(GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN));
 ULONG_PTR gdiplusToken;
 HWND hStartBtn;
 HWND hOverlay = NULL;
@@ -28,8 +32,32 @@ const int LIST_START_Y = 100;
 const int ITEM_HEIGHT = 30;
 
 // Forward declarations
+// Same settings as the tracker: the snails can chase a replayed log or the
+// synthetic sweep, so the game path can be load-tested without a hand on the mouse
+void SelectCursorSource() {
+    wchar_t path[MAX_PATH];
+    GetCurrentDirectory(MAX_PATH, path);
+    wcscat(path, L"\\settings.ini");
+
+    wchar_t name[32];
+    wchar_t replayFile[MAX_PATH];
+    GetPrivateProfileString(L"Settings", L"CursorSource", L"system", name, 32, path);
+    GetPrivateProfileString(L"Settings", L"ReplayFile", L"replay_log.txt", replayFile, MAX_PATH, path);
+
+    CursorSource* source = NULL; // The game's own GetCursorPos source
+    if (wcscmp(name, L"replay") == 0) {
+        char file[MAX_PATH];
+        WideCharToMultiByte(CP_ACP, 0, replayFile, -1, file, MAX_PATH, NULL, NULL);
+        if (g_replaySource.Open(file)) source = &g_replaySource;
+    } else if (wcscmp(name, L"synthetic") == 0) {
+        source = &g_syntheticSource;
+    }
+    g_snailGame.SetCursorSource(source);
+}
+
 LRESULT CALLBACK ControlProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK OverlayProc(HWND, UINT, WPARAM, LPARAM);
+void SelectCursorSource();
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine, int nCmdShow) {
     GdiplusStartupInput gdiplusStartupInput;
@@ -52,6 +80,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine,
     RegisterClass(&wcOverlay);
 
     g_snailGame.Init(GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN));
+    SelectCursorSource();
 
     hControlWnd = CreateWindowEx(0, CONTROL_CLASS_NAME, L"Snail Game Control", WS_OVERLAPPEDWINDOW | WS_VISIBLE, CW_USEDEFAULT, CW_USEDEFAULT, 400, 600, NULL, NULL, hInstance, NULL);
 
@@ -4,7 +4,7 @@
 #include <stdlib.h>
 #include <algorithm>
 
-SnailGame::SnailGame() : m_isRunning(false), m_screenW(0), m_screenH(0), m_nextId(1) {
+SnailGame::SnailGame() : m_isRunning(false), m_screenW(0), m_screenH(0), m_nextId(1), m_cursor(&m_systemCursor) {
     srand((unsigned int)time(NULL));
 }
 
@@ -57,7 +57,10 @@ void SnailGame::Update() {
     if (!m_isRunning) return;
 
     POINT cursorPos;
-    GetCursorPos(&cursorPos);
+    int cx, cy;
+    if (!m_cursor->GetPosition(cx, cy)) return;
+    cursorPos.x = cx;
+    cursorPos.y = cy;
 
     for (auto& snail : m_snails) {
         float dx = (float)cursorPos.x - snail.x;
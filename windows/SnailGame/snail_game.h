@@ -1,6 +1,7 @@
 #pragma once
 #include <windows.h>
 #include <vector>
+#include "cursor_source.h"
 
 struct Snail {
     int id;
@@ -25,9 +26,15 @@ public:
     void Stop() { m_isRunning = false; }
     void Start() { m_isRunning = true; }
 
+    // Where the snails look for the cursor (defaults to the real one)
+    void SetCursorSource(CursorSource* source) { m_cursor = source ? source : &m_systemCursor; }
+
 private:
     std::vector<Snail> m_snails;
     int m_nextId;
     int m_screenW, m_screenH;
     bool m_isRunning;
+
+    Win32CursorSource m_systemCursor;
+    CursorSource* m_cursor;
 };
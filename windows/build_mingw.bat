@@ -1,6 +1,6 @@
 @echo off
 echo Attempting to build with MinGW (g++)...
-g++ -o MouseTracker.exe main.cpp tron_game.cpp -mwindows -O2 -s -lgdiplus
+g++ -o MouseTracker.exe main.cpp tron_game.cpp ../common/trail_log.cpp ../common/async_logger.cpp ../common/trail_ring.cpp ../common/trail_segments.cpp ../common/trail_columns.cpp ../common/trail_store.cpp ../common/trail_view.cpp ../common/mapped_file.cpp ../common/cursor_source.cpp -I../common -mwindows -O2 -s -lgdiplus
 if %ERRORLEVEL% EQU 0 (
     echo.
     echo ---------------------------------------
@@ -1,6 +1,6 @@
 @echo off
 echo Attempting to build with MSVC (cl.exe)...
-cl.exe /nologo /O1 main.cpp user32.lib gdi32.lib gdiplus.lib /Fe:MouseTracker.exe
+cl.exe /nologo /O1 /I..\common main.cpp ..\common\trail_log.cpp ..\common\async_logger.cpp ..\common\trail_ring.cpp ..\common\trail_segments.cpp ..\common\trail_columns.cpp ..\common\trail_store.cpp ..\common\trail_view.cpp ..\common\mapped_file.cpp ..\common\cursor_source.cpp user32.lib gdi32.lib gdiplus.lib /Fe:MouseTracker.exe
 if %ERRORLEVEL% EQU 0 (
     echo.
     echo ---------------------------------------
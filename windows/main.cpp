@@ -6,16 +6,27 @@
 #include <stdio.h>
 #include <vector>
 #include <deque>
+#include <string>
 #include <gdiplus.h>
 #include "tron_game.h"
+#include "adaptive_sampler.h"
+#include "trail_clock.h"
+#include "trail_log.h"
+#include "async_logger.h"
+#include "cursor_source.h"
+#include "trail_store.h"
+#include "trail_view.h"
 
 using namespace Gdiplus;
 #pragma comment (lib,"gdiplus.lib")
 
 // Global Variables
 BOOL isTracking = FALSE;
-FILE* logFile = NULL;
+AsyncTrailLogger logWriter;
 const wchar_t LOG_FILENAME[] = L"mouse_log.txt";
+const wchar_t LOG_FILENAME_BINARY[] = L"mouse_log.bin";
+const wchar_t LOG_FILENAME_RING[] = L"mouse_log.ring";
+const char LOG_SEGMENT_BASE[] = "mouse_log"; // + .manifest / .000001.txt
 const wchar_t CONTROL_CLASS_NAME[] = L"ControlWindowClass";
 const wchar_t TRAIL_CLASS_NAME[] = L"TrailWindowClass";
 const wchar_t LIVE_OVERLAY_CLASS_NAME[] = L"LiveOverlayClass";
@@ -23,6 +34,7 @@ const wchar_t GAME_OVERLAY_CLASS_NAME[] = L"GameOverlayClass";
 const wchar_t SETTINGS_FILENAME[] = L"settings.ini";
 
 std::vector<POINT> g_trailPoints;
+TrailPointView g_reviewView; // Binary log / ring review, drawn from the file instead of g_trailPoints
 std::deque<POINT> g_livePoints;
 ULONG_PTR gdiplusToken;
 TronGame g_tronGame;
@@ -31,9 +43,32 @@ TronGame g_tronGame;
 int g_interval = 50;      
 int g_penWidth = 2;
 COLORREF g_penColor = RGB(0, 255, 0); 
-BOOL g_autoClear = TRUE; 
+int g_autoClear = 1;      // 1 = truncate on START, 0 = append, 2 = ring file
+int g_ringFileMB = 64;
+BOOL g_segmented = FALSE; // SegmentMB / SegmentMinutes set
+int g_reviewMinutes = 0;  // 0 = review the latest session
+int g_parallelLoadMB = 64; // Text logs this large load on every core (0 = never)
+int g_loadThreads = 0;     // 0 = one per core
+TrailStore g_trailStore;   // This session's points, for the review
+long long g_sessionWallNs = 0; // When the latest session started
 int g_trailLength = 20;
 int g_tronAiCount = 3; 
+int g_idleInterval = 250; // ms, rate used while the cursor is parked
+int g_idleAfter = 5;      // unchanged samples before switching to it
+TrailFormat g_logFormat = TRAIL_FORMAT_TEXT;
+
+// Cursor sources (CursorSource= system | replay | synthetic)
+wchar_t g_cursorSourceName[32] = L"system";
+wchar_t g_replayFile[MAX_PATH] = L"replay_log.txt";
+Win32CursorSource g_systemSource;
+ReplayCursorSource g_replaySource;
+SyntheticCursorSource g_syntheticSource(GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN));
+CursorSource* g_source = &g_systemSource;
+
+// Adaptive sampling state
+AdaptiveSampler g_sampler;
+int g_timerInterval = 0;  // what timer 1 is currently armed with
+bool g_rotationFailing = false; // Last state reported by the logger, shown in the title
 
 // Initial Interface States
 BOOL g_showLive = FALSE;
@@ -52,6 +87,9 @@ LRESULT CALLBACK LiveOverlayProc(HWND, UINT, WPARAM, LPARAM);
 LRESULT CALLBACK GameOverlayProc(HWND, UINT, WPARAM, LPARAM);
 void LoadPointsFromFile();
 void LoadSettings();
+void SelectCursorSource();
+const wchar_t* LogFileName();
+bool OpenLog();
 int GetEncoderClsid(const WCHAR* format, CLSID* pClsid);
 void SaveScreenToJPG();
 
@@ -132,16 +170,18 @@ LRESULT CALLBACK ControlProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
     case WM_COMMAND:
         if (LOWORD(wParam) == 1) { // START
-            const wchar_t* mode = g_autoClear ? L"w" : L"a";
-            logFile = _wfopen(LOG_FILENAME, mode);
-            if (logFile != NULL) {
+            g_reviewView.Close(); // A mapped log can't be truncated or appended to
+            if (OpenLog()) {
+                SelectCursorSource();
                 isTracking = TRUE;
                 g_livePoints.clear();
                 if (SendMessage(hLiveCheck, BM_GETCHECK, 0, 0) == BST_CHECKED) {
                     hLiveOverlay = CreateWindowEx(WS_EX_TOPMOST | WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_TOOLWINDOW, LIVE_OVERLAY_CLASS_NAME, L"LiveTrail", WS_POPUP | WS_VISIBLE | WS_MAXIMIZE, 0, 0, GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN), NULL, NULL, GetModuleHandle(NULL), NULL);
                     SetLayeredWindowAttributes(hLiveOverlay, RGB(0,0,0), 0, LWA_COLORKEY);
                 }
-                SetTimer(hwnd, 1, g_interval, NULL); 
+                g_sampler.Configure(g_interval, g_idleInterval, g_idleAfter);
+                g_timerInterval = g_interval;
+                SetTimer(hwnd, 1, g_timerInterval, NULL); 
                 EnableWindow(hStartBtn, FALSE);
                 EnableWindow(hLiveCheck, FALSE); 
                 EnableWindow(hResultCheck, FALSE);
@@ -157,7 +197,7 @@ LRESULT CALLBACK ControlProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             isTracking = FALSE;
             
             if (hLiveOverlay) { DestroyWindow(hLiveOverlay); hLiveOverlay = NULL; }
-            if (logFile) { fclose(logFile); logFile = NULL; }
+            logWriter.Close();
 
             EnableWindow(hStartBtn, TRUE);
             EnableWindow(hLiveCheck, TRUE);
@@ -168,7 +208,8 @@ LRESULT CALLBACK ControlProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
             LoadPointsFromFile();
             
-            if (SendMessage(hAutoSaveCheck, BM_GETCHECK, 0, 0) == BST_CHECKED && !g_trailPoints.empty()) {
+            BOOL haveTrail = !g_trailPoints.empty() || g_reviewView.IsOpen();
+            if (SendMessage(hAutoSaveCheck, BM_GETCHECK, 0, 0) == BST_CHECKED && haveTrail) {
                 HWND hTrail = CreateWindowEx(WS_EX_TOPMOST | WS_EX_LAYERED, TRAIL_CLASS_NAME, L"Mouse Trail", WS_POPUP | WS_VISIBLE | WS_MAXIMIZE, 0, 0, GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN), NULL, NULL, GetModuleHandle(NULL), NULL);
                 SetLayeredWindowAttributes(hTrail, RGB(0,0,0), 0, LWA_COLORKEY);
                 ShowWindow(hTrail, SW_SHOWMAXIMIZED);
@@ -180,7 +221,7 @@ LRESULT CALLBACK ControlProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 return 0; 
             }
 
-            if (!g_trailPoints.empty()) {
+            if (haveTrail) {
                 if (SendMessage(hResultCheck, BM_GETCHECK, 0, 0) == BST_CHECKED) {
                     HWND hTrail = CreateWindowEx(WS_EX_TOPMOST | WS_EX_LAYERED, TRAIL_CLASS_NAME, L"Mouse Trail", WS_POPUP | WS_VISIBLE | WS_MAXIMIZE, 0, 0, GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN), NULL, NULL, GetModuleHandle(NULL), NULL);
                     SetLayeredWindowAttributes(hTrail, RGB(0,0,0), 0, LWA_COLORKEY);
@@ -194,6 +235,8 @@ LRESULT CALLBACK ControlProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             if (hGameOverlay == NULL) {
                 hGameOverlay = CreateWindowEx(WS_EX_TOPMOST | WS_EX_LAYERED | WS_EX_TRANSPARENT | WS_EX_TOOLWINDOW, GAME_OVERLAY_CLASS_NAME, L"TronOverlay", WS_POPUP | WS_VISIBLE | WS_MAXIMIZE, 0, 0, GetSystemMetrics(SM_CXSCREEN), GetSystemMetrics(SM_CYSCREEN), NULL, NULL, GetModuleHandle(NULL), NULL);
                 SetLayeredWindowAttributes(hGameOverlay, RGB(0,0,0), 0, LWA_COLORKEY);
+                SelectCursorSource();
+                g_tronGame.SetCursorSource(g_source);
                 g_tronGame.StartGame(g_tronAiCount);
                 SetTimer(hwnd, 2, 16, NULL); 
                 EnableWindow(hStartBtn, FALSE);
@@ -203,16 +246,31 @@ LRESULT CALLBACK ControlProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         break;
 
     case WM_TIMER:
-        if (wParam == 1 && isTracking && logFile) {
-            POINT p;
-            if (GetCursorPos(&p)) {
-                fprintf(logFile, "%d,%d\n", p.x, p.y);
-                fflush(logFile); 
+        if (wParam == 1 && isTracking && logWriter.IsOpen()) {
+            TrailSample s;
+            if (g_source->Sample(s)) {
+                POINT p = { s.x, s.y };
+                logWriter.Append(s);
+                logWriter.Flush(); 
+                if (logWriter.IsRotationFailing() != g_rotationFailing) {
+                    g_rotationFailing = !g_rotationFailing;
+                    wchar_t title[96];
+                    wsprintf(title, g_rotationFailing ? L"Tracker - can't start a new log segment" : L"Tracker (Interval: %dms)", g_interval);
+                    SetWindowText(hwnd, title);
+                }
+                g_trailStore.Append(s);
                 if (hLiveOverlay) {
                     g_livePoints.push_back(p);
                     if (g_livePoints.size() > (size_t)g_trailLength) g_livePoints.pop_front();
                     InvalidateRect(hLiveOverlay, NULL, TRUE);
                 }
+
+                // Slow down while parked, back to Interval on the first movement
+                int next = g_sampler.Next(p.x, p.y);
+                if (next != g_timerInterval) {
+                    g_timerInterval = next;
+                    SetTimer(hwnd, 1, g_timerInterval, NULL);
+                }
             }
         }
         else if (wParam == 2 && hGameOverlay) {
@@ -229,7 +287,7 @@ LRESULT CALLBACK ControlProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         break;
 
     case WM_DESTROY:
-        if (logFile) fclose(logFile);
+        logWriter.Close();
         PostQuitMessage(0);
         return 0;
     }
@@ -244,7 +302,22 @@ LRESULT CALLBACK TrailProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
             HDC hdc = BeginPaint(hwnd, &ps);
             HPEN hPen = CreatePen(PS_SOLID, g_penWidth, g_penColor); 
             HGDIOBJ oldPen = SelectObject(hdc, hPen);
-            if (g_trailPoints.size() > 0) {
+            if (g_reviewView.IsOpen()) {
+                // Straight from the mapped log, a batch at a time
+                const TrailPoint* p;
+                size_t n;
+                bool first = true;
+                g_reviewView.Rewind();
+                while ((n = g_reviewView.Next(p)) > 0) {
+                    size_t i = 0;
+                    if (first) {
+                        MoveToEx(hdc, p[0].x, p[0].y, NULL);
+                        i = 1;
+                        first = false;
+                    }
+                    for (; i < n; ++i) LineTo(hdc, p[i].x, p[i].y);
+                }
+            } else if (g_trailPoints.size() > 0) {
                 MoveToEx(hdc, g_trailPoints[0].x, g_trailPoints[0].y, NULL);
                 for (size_t i = 1; i < g_trailPoints.size(); ++i) {
                     LineTo(hdc, g_trailPoints[i].x, g_trailPoints[i].y);
@@ -261,6 +334,7 @@ LRESULT CALLBACK TrailProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
             MessageBox(hwnd, L"Saved trail.jpg", L"Saved", MB_OK);
         } else if (wParam == VK_ESCAPE) {
             g_trailPoints.clear(); 
+            g_reviewView.Close();
             DestroyWindow(hwnd);
         }
         break;
@@ -354,19 +428,72 @@ LRESULT CALLBACK GameOverlayProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPa
     return DefWindowProc(hwnd, uMsg, wParam, lParam);
 }
 
+// TrailReader or TrailSegmentReader
+template <class Reader>
+void LoadPoints(Reader& reader) {
+    TrailSample s;
+    long long count;
+    g_trailPoints.reserve(g_trailPoints.size() + reader.EstimateRecords());
+    // A run of n identical samples draws as a single vertex
+    while (reader.Next(s, count)) {
+        POINT p = {s.x, s.y};
+        g_trailPoints.push_back(p);
+    }
+}
+
+void AddPoints(const std::vector<TrailPoint>& points) {
+    g_trailPoints.reserve(g_trailPoints.size() + points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        POINT p = {points[i].x, points[i].y};
+        g_trailPoints.push_back(p);
+    }
+}
+
+// Puts a reader of the single-file log at the start of the review
+void SeekReview(TrailReader& reader, long long from) {
+    if (from > 0 && reader.GetWallNs() != 0) {
+        // The index jumps straight to the review window
+        std::wstring index = std::wstring(LogFileName()) + L".idx";
+        reader.OpenIndex(_wfopen(index.c_str(), L"rb"));
+        reader.SeekToTime(from - reader.GetWallNs() + reader.GetMonoNs());
+    } else if (from == 0) {
+        reader.SeekToLastSession(); // Older appended sessions aren't read at all
+    }
+}
+
+// From memory when it has the whole review, else from the log (or a view of it)
 void LoadPointsFromFile() {
     g_trailPoints.clear();
-    FILE* f = _wfopen(LOG_FILENAME, L"r");
-    if (f != NULL) {
-        int x, y;
-        char line[128];
-        while (fgets(line, sizeof(line), f)) {
-            if (sscanf(line, "%d,%d", &x, &y) == 2) {
-                POINT p = {x, y};
-                g_trailPoints.push_back(p);
+    g_reviewView.Close();
+    long long from = g_reviewMinutes > 0 ? GetWallClockNs() - g_reviewMinutes * 60LL * 1000000000LL : 0;
+    // The log is only read back for earlier sessions (AutoClear=0 or ring)
+    // inside ReviewMinutes, or when this one outgrew ReviewMemoryMB
+    bool history = g_autoClear != 1 && from > 0 && from < g_trailStore.GetWallNs();
+    if (g_trailStore.IsComplete() && !history) {
+        std::vector<TrailPoint> points;
+        g_trailStore.TakePoints(from, points);
+        AddPoints(points);
+    } else if (g_segmented) {
+        // Only the segments overlapping the review window are opened
+        TrailSegmentReader reader;
+        if (reader.Open(TrailManifestPath(LOG_SEGMENT_BASE).c_str(), from ? from : g_sessionWallNs)) LoadPoints(reader);
+    } else if (g_reviewView.Open(_wfopen(LogFileName(), L"rb"))) {
+        // A binary log or ring is drawn straight from the file: nothing to load
+        SeekReview(g_reviewView.GetReader(), from);
+        const TrailPoint* first;
+        if (!g_reviewView.Rewind() || g_reviewView.Next(first) == 0) g_reviewView.Close();
+    } else {
+        TrailReader reader;
+        if (reader.Open(_wfopen(LogFileName(), L"rb"))) {
+            SeekReview(reader, from);
+            std::vector<TrailPoint> points;
+            if (g_parallelLoadMB > 0 &&
+                reader.ReadPoints(points, g_loadThreads, g_parallelLoadMB * 1024ULL * 1024ULL)) {
+                AddPoints(points);
+            } else {
+                LoadPoints(reader);
             }
         }
-        fclose(f);
     }
 }
 
@@ -383,6 +510,19 @@ void LoadSettings() {
     int b = GetPrivateProfileInt(L"Settings", L"ColorB", 0, path);
     g_penColor = RGB(r, g, b);
     g_autoClear = GetPrivateProfileInt(L"Settings", L"AutoClear", 1, path);
+    g_ringFileMB = GetPrivateProfileInt(L"Settings", L"RingFileMB", 64, path);
+    if (g_ringFileMB < 1) g_ringFileMB = 1;
+    if (g_ringFileMB > 2000) g_ringFileMB = 2000;
+    int segmentMB = GetPrivateProfileInt(L"Settings", L"SegmentMB", 0, path);
+    int segmentMinutes = GetPrivateProfileInt(L"Settings", L"SegmentMinutes", 0, path);
+    g_segmented = segmentMB > 0 || segmentMinutes > 0;
+    logWriter.SetSegmentLimits(segmentMB, segmentMinutes, GetPrivateProfileInt(L"Settings", L"SegmentKeep", 0, path));
+    g_reviewMinutes = GetPrivateProfileInt(L"Settings", L"ReviewMinutes", 0, path);
+    g_parallelLoadMB = GetPrivateProfileInt(L"Settings", L"ParallelLoadMB", 64, path);
+    g_loadThreads = GetPrivateProfileInt(L"Settings", L"LoadThreads", 0, path);
+    int reviewMemoryMB = GetPrivateProfileInt(L"Settings", L"ReviewMemoryMB", 256, path);
+    g_trailStore.SetLimit(reviewMemoryMB > 0 ? reviewMemoryMB * 1024ULL * 1024ULL : 0);
+    logWriter.SetIndexEvery(GetPrivateProfileInt(L"Settings", L"IndexEvery", 1000, path));
     g_trailLength = GetPrivateProfileInt(L"Settings", L"TrailLength", 20, path);
 
     g_showLive = GetPrivateProfileInt(L"Settings", L"ShowLiveTrail", 0, path);
@@ -390,6 +530,62 @@ void LoadSettings() {
     g_autoSave = GetPrivateProfileInt(L"Settings", L"AutoSave", 0, path);
 
     g_tronAiCount = GetPrivateProfileInt(L"Settings", L"TronAICount", 3, path);
+
+    g_idleInterval = GetPrivateProfileInt(L"Settings", L"IdleInterval", 250, path);
+    g_idleAfter = GetPrivateProfileInt(L"Settings", L"IdleAfter", 5, path);
+
+    GetPrivateProfileString(L"Settings", L"CursorSource", L"system", g_cursorSourceName, 32, path);
+    GetPrivateProfileString(L"Settings", L"ReplayFile", L"replay_log.txt", g_replayFile, MAX_PATH, path);
+
+    wchar_t format[16];
+    GetPrivateProfileString(L"Settings", L"LogFormat", L"text", format, 16, path);
+    g_logFormat = TRAIL_FORMAT_TEXT;
+    if (wcscmp(format, L"binary") == 0) g_logFormat = TRAIL_FORMAT_BINARY;
+    else if (wcscmp(format, L"columnar") == 0) g_logFormat = TRAIL_FORMAT_COLUMNAR;
+
+    wchar_t durability[16];
+    GetPrivateProfileString(L"Settings", L"Durability", L"none", durability, 16, path);
+    TrailDurability sync = TRAIL_SYNC_NONE;
+    if (wcscmp(durability, L"batch") == 0) sync = TRAIL_SYNC_BATCH;
+    else if (wcscmp(durability, L"every") == 0) sync = TRAIL_SYNC_EVERY;
+    logWriter.SetCommitPolicy(GetPrivateProfileInt(L"Settings", L"CommitSamples", 1000, path),
+                              GetPrivateProfileInt(L"Settings", L"CommitMs", 1000, path), sync);
+}
+
+const wchar_t* LogFileName() {
+    if (g_autoClear == 2) return LOG_FILENAME_RING;
+    return g_logFormat != TRAIL_FORMAT_TEXT ? LOG_FILENAME_BINARY : LOG_FILENAME;
+}
+
+// New session in the log, as AutoClear says
+bool OpenLog() {
+    g_sessionWallNs = GetWallClockNs();
+    g_trailStore.Begin();
+    int w = GetSystemMetrics(SM_CXSCREEN), h = GetSystemMetrics(SM_CYSCREEN);
+    if (g_autoClear == 2) {
+        char path[MAX_PATH];
+        WideCharToMultiByte(CP_ACP, 0, LOG_FILENAME_RING, -1, path, MAX_PATH, NULL, NULL);
+        return logWriter.OpenRing(path, (size_t)g_ringFileMB << 20, g_interval, w, h);
+    }
+    if (g_segmented) return logWriter.OpenSegments(LOG_SEGMENT_BASE, g_autoClear == 0, g_interval, g_logFormat, w, h);
+
+    FILE* f = _wfopen(LogFileName(), g_autoClear ? L"wb" : L"ab");
+    if (!f) return false;
+    std::wstring index = std::wstring(LogFileName()) + L".idx";
+    logWriter.Open(f, g_interval, g_logFormat, w, h, _wfopen(index.c_str(), g_autoClear ? L"wb" : L"ab"));
+    return true;
+}
+
+void SelectCursorSource() {
+    g_source = &g_systemSource;
+
+    if (wcscmp(g_cursorSourceName, L"replay") == 0) {
+        char path[MAX_PATH];
+        WideCharToMultiByte(CP_ACP, 0, g_replayFile, -1, path, MAX_PATH, NULL, NULL);
+        if (g_replaySource.Open(path)) g_source = &g_replaySource;
+    } else if (wcscmp(g_cursorSourceName, L"synthetic") == 0) {
+        g_source = &g_syntheticSource;
+    }
 }
 
 int GetEncoderClsid(const WCHAR* format, CLSID* pClsid) {
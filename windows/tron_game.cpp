@@ -2,7 +2,7 @@
 #include <math.h>
 #include <time.h>
 
-TronGame::TronGame() : m_state(GAME_IDLE), m_speed(5) {
+TronGame::TronGame() : m_state(GAME_IDLE), m_speed(5), m_cursor(&m_systemCursor) {
     srand((unsigned int)time(NULL));
 }
 
@@ -18,8 +18,9 @@ void TronGame::StartGame(int aiCount) {
     m_state = GAME_RUNNING;
 
     // 1. Add Player Bike (Starts at mouse pos)
-    POINT p;
-    GetCursorPos(&p);
+    int cx = 0, cy = 0;
+    m_cursor->GetPosition(cx, cy);
+    POINT p = { cx, cy };
     Bike player;
     player.x = (float)p.x;
     player.y = (float)p.y;
@@ -88,8 +89,9 @@ void TronGame::UpdatePlayerBike(Bike& b) {
     // BUT to match "Mouse Tracker", maybe we just use Cursor Position directly?
     // Let's stick to CURSOR POSITION directly as the user implies "GetCursorPos -> bike".
     
-    POINT p;
-    GetCursorPos(&p);
+    int cx, cy;
+    if (!m_cursor->GetPosition(cx, cy)) return;
+    POINT p = { cx, cy };
     
     // Calculate direction based on movement for visuals
     if (abs(p.x - (long)b.x) > abs(p.y - (long)b.y)) {
@@ -9,6 +9,7 @@
 #include <windows.h>
 #include <vector>
 #include <deque>
+#include "cursor_source.h"
 
 enum Direction { UP, DOWN, LEFT, RIGHT };
 enum BikeState { ALIVE, DEAD };
@@ -40,6 +41,9 @@ public:
     void StartGame(int aiCount);
     void Update();
     void HandleInput(int key);
+
+    // Where the player bike reads the cursor (defaults to the real one)
+    void SetCursorSource(CursorSource* source) { m_cursor = source ? source : &m_systemCursor; }
     
     // Getters for rendering
     const std::vector<Bike>& GetBikes() const { return m_bikes; }
@@ -56,6 +60,9 @@ private:
     int m_speed;
     GameState m_state;
     std::vector<Bike> m_bikes;
+
+    Win32CursorSource m_systemCursor;
+    CursorSource* m_cursor;
 };
 
 #endif